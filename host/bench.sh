@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# Build and run the EvLog host benchmark for linear and circular logging with
+# every EVLOG_TIMESTAMP_* option.
+#
+#   host/bench.sh                   run, print a table of ns per call, and
+#                                   of evlogPrintReport() us per 1000 entries
+#   host/bench.sh -s FILE           also save the results to FILE
+#   host/bench.sh -b FILE [-t PCT]  fail when a result is more than PCT
+#                                   percent (default 25) slower than FILE
+#
+# CXX and CXXFLAGS are honored. BUILD_DIR defaults to /tmp/evlog-host.
+#
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${BUILD_DIR:-/tmp/evlog-host}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2}
+SAVE=
+BASELINE=
+TOLERANCE=25
+
+while getopts "s:b:t:" opt; do
+  case $opt in
+    s) SAVE=$OPTARG ;;
+    b) BASELINE=$OPTARG ;;
+    t) TOLERANCE=$OPTARG ;;
+    *) exit 2 ;;
+  esac
+done
+
+# Sources include <evlog/src/...>, as installed in an Arduino library folder.
+mkdir -p "$BUILD_DIR/include"
+ln -sfn "$ROOT" "$BUILD_DIR/include/evlog"
+
+RESULTS="$BUILD_DIR/bench_results.txt"
+: > "$RESULTS"
+HEADER=-h
+for mode in linear circular; do
+  for ts in CLOCKCYCLES MICROS MILLIS NONE; do
+    defs="-DEVLOG_ENABLE -DEVLOG_HOST -DEVLOG_HOST_RESERVE_SIZE=65536"
+    [ "$mode" = circular ] && defs="$defs -DEVLOG_CIRCULAR"
+    if [ "$ts" = NONE ]; then
+      defs="$defs -DEVLOG_TIMESTAMP=0"
+    else
+      defs="$defs -DEVLOG_TIMESTAMP=EVLOG_TIMESTAMP_$ts"
+    fi
+    exe="$BUILD_DIR/evlog_bench_${mode}_$ts"
+    $CXX $CXXFLAGS $defs -I"$BUILD_DIR/include" -o "$exe" \
+      "$ROOT/src/event_logger.cpp" "$ROOT/src/evlog_host.cpp" "$ROOT/host/evlog_bench.cpp"
+    # The report timing does not depend on the mode, run it once.
+    report=
+    [ "$mode" = linear ] && report=-r
+    "$exe" $HEADER $report | tee -a "$RESULTS"
+    HEADER=
+  done
+done
+
+[ -n "$SAVE" ] && grep -v '^mode' "$RESULTS" > "$SAVE"
+
+if [ -n "$BASELINE" ]; then
+  # Compare each column of matching mode/timestamp rows.
+  awk -v tol="$TOLERANCE" '
+    NR == FNR { if ($1 != "mode") for (i = 3; i <= NF; i++) base[$1 " " $2, i] = $i; next }
+    $1 == "mode" { for (i = 3; i <= NF; i++) name[i] = $i; next }
+    {
+      for (i = 3; i <= NF; i++) {
+        b = base[$1 " " $2, i]
+        if (b > 0 && $i > b * (1 + tol / 100)) {
+          if ($1 == "report")
+            printf("REGRESSION %s %s: %.1f us per 1000 entries, baseline %.1f us\n", $1, $2, $i, b)
+          else
+            printf("REGRESSION %s %s %s: %.2f ns, baseline %.2f ns\n", $1, $2, name[i], $i, b)
+          bad = 1
+        }
+      }
+    }
+    END { exit bad }' "$BASELINE" "$RESULTS"
+fi
@@ -0,0 +1,236 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Host benchmark of the EvLog logging calls.
+
+    Reports the median ns per call for EVLOG1 .. EVLOG5 and for EVLOG5 with
+    logging stopped. One binary measures one build configuration; bench.sh
+    builds and runs each of linear/circular and every EVLOG_TIMESTAMP_* option.
+
+    Output is one line per configuration:
+      <mode> <timestamp> <EVLOG1> <EVLOG2> <EVLOG3> <EVLOG4> <EVLOG5> <disabled>
+
+    Options:
+      -h  print a header line first
+      -c  also run the built-in evlog_calibrate() and print its report
+      -r  also time evlogPrintReport(), one more line:
+            report <timestamp> <us per 1000 entries> <heap allocations>
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <new>
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+
+#ifndef BENCH_BATCH
+#define BENCH_BATCH (256U)    // Calls per timed batch, must fit in the log
+#endif
+#ifndef BENCH_REPEAT
+#define BENCH_REPEAT (101U)   // Timed batches per measurement, median is kept
+#endif
+
+#ifdef EVLOG_CIRCULAR
+static const char *mode_name = "circular";
+#else
+static const char *mode_name = "linear";
+#endif
+
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+static const char *ts_name = "CLOCKCYCLES";
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
+static const char *ts_name = "MICROS";
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+static const char *ts_name = "MILLIS";
+#else
+static const char *ts_name = "NONE";
+#endif
+
+#ifndef BENCH_REPORT_EVENTS
+#define BENCH_REPORT_EVENTS (1000U)
+#endif
+
+// Counts C++ heap allocations, the host String and Print use these.
+static size_t heap_allocs = 0;
+
+void *operator new(size_t size) {
+    heap_allocs++;
+    void *p = malloc((size) ? size : 1U);
+    if (NULL == p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+// Takes the report and drops it.
+class NullPrint : public Print {
+public:
+    using Print::write;
+    size_t write(uint8_t) override { return 1U; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+enum bench_call {
+    BENCH_EVLOG1, BENCH_EVLOG2, BENCH_EVLOG3, BENCH_EVLOG4, BENCH_EVLOG5,
+    BENCH_DISABLED, BENCH_EMPTY
+};
+
+/*
+  The log is restarted before each batch so every timed call takes the
+  normal store path. Linear logging would otherwise stop after MAX_EVENTS.
+*/
+static uint64_t __attribute__((noinline)) time_batch(bench_call which) {
+    evlog_restart(1U);
+    if (BENCH_DISABLED == which)
+        evlog_stop();
+
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < BENCH_BATCH; i++) {
+        switch (which) {
+            case BENCH_EVLOG1:   EVLOG1("bench"); break;
+            case BENCH_EVLOG2:   EVLOG2("bench %u", i); break;
+            case BENCH_EVLOG3:   EVLOG3("bench %u %u", i, i); break;
+            case BENCH_EVLOG4:   EVLOG4("bench %u %u %u", i, i, i); break;
+            case BENCH_EVLOG5:
+            case BENCH_DISABLED: EVLOG5("bench %u %u %u %u", i, i, i, i); break;
+            default:             asm volatile("":::"memory"); break;
+        }
+    }
+    return now_ns() - start;
+}
+
+static double measure(bench_call which) {
+    static double samples[BENCH_REPEAT];
+    for (size_t i = 0; i < 8U; i++)
+        time_batch(which);  // warm up
+
+    for (size_t i = 0; i < BENCH_REPEAT; i++)
+        samples[i] = (double)time_batch(which) / BENCH_BATCH;
+
+    qsort(samples, BENCH_REPEAT, sizeof(samples[0]), cmp_double);
+    return samples[BENCH_REPEAT / 2U];
+}
+
+/*
+  Median time of evlogPrintReport() over BENCH_REPORT_EVENTS entries, in us
+  per 1000 entries. `allocs` gets the heap allocations of one report.
+*/
+static double measure_report(size_t *allocs) {
+    static double samples[BENCH_REPEAT / 4U];
+    NullPrint out;
+    evlog_restart(1U);
+    for (uint32_t i = 1; i < BENCH_REPORT_EVENTS; i++)
+        EVLOG5("report %u 0x%08X %u %u", i, i * 2654435761U, i & 0xFFU, 100000U - i);
+    if (BENCH_REPORT_EVENTS != evlog_get_count())
+        return -1.0;
+
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        size_t before = heap_allocs;
+        uint64_t start = now_ns();
+        evlogPrintReport(out);
+        samples[i] = (double)(now_ns() - start) / 1000.0 * 1000.0 / BENCH_REPORT_EVENTS;
+        *allocs = heap_allocs - before;
+    }
+    qsort(samples, sizeof(samples) / sizeof(samples[0]), sizeof(samples[0]), cmp_double);
+    return samples[sizeof(samples) / sizeof(samples[0]) / 2U];
+}
+
+int main(int argc, char **argv) {
+    bool header = false;
+    bool calibrate = false;
+    bool report = false;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "-h"))
+            header = true;
+        else if (0 == strcmp(argv[i], "-c"))
+            calibrate = true;
+        else if (0 == strcmp(argv[i], "-r"))
+            report = true;
+    }
+
+    // Pin to the CPU we started on, for steady numbers.
+    int cpu = sched_getcpu();
+    if (0 <= cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+
+    evlog_preinit(1U);
+    // Check a batch fits, a short log would time the stopped path.
+    evlog_restart(1U);
+    for (uint32_t i = 1; i < BENCH_BATCH; i++)
+        EVLOG1("fit");
+    if (BENCH_BATCH != evlog_get_count()) {
+        fprintf(stderr, "Log holds %u events, BENCH_BATCH is %u. Increase EVLOG_HOST_RESERVE_SIZE.\n",
+            evlog_get_count(), (unsigned)BENCH_BATCH);
+        return 1;
+    }
+
+    double empty = measure(BENCH_EMPTY);
+    double ns[BENCH_EMPTY];
+    for (int i = BENCH_EVLOG1; i < BENCH_EMPTY; i++) {
+        ns[i] = measure((bench_call)i) - empty;
+        if (ns[i] < 0.0)
+            ns[i] = 0.0;
+    }
+
+    if (header)
+        printf("%-8s %-11s %7s %7s %7s %7s %7s %8s\n",
+            "mode", "timestamp", "EVLOG1", "EVLOG2", "EVLOG3", "EVLOG4", "EVLOG5", "disabled");
+
+    printf("%-8s %-11s %7.2f %7.2f %7.2f %7.2f %7.2f %8.2f\n", mode_name, ts_name,
+        ns[BENCH_EVLOG1], ns[BENCH_EVLOG2], ns[BENCH_EVLOG3], ns[BENCH_EVLOG4],
+        ns[BENCH_EVLOG5], ns[BENCH_DISABLED]);
+
+    if (report) {
+        size_t allocs = 0;
+        double us = measure_report(&allocs);
+        if (0.0 > us) {
+            fprintf(stderr, "Log holds %u events, BENCH_REPORT_EVENTS is %u. Increase EVLOG_HOST_RESERVE_SIZE.\n",
+                evlog_get_count(), (unsigned)BENCH_REPORT_EVENTS);
+            return 1;
+        }
+        printf("%-8s %-11s %7.1f %7u\n", "report", ts_name, us, (unsigned)allocs);
+    }
+
+    if (calibrate) {
+        evlog_restart(1U);
+        evlog_calibrate(EVLOG_CALIBRATE_MAX);
+        evlogPrintCalibration(Serial);
+    }
+    return 0;
+}
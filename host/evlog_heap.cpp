@@ -0,0 +1,226 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Heap timeline from the evlog_heap.cpp records in a dump written by
+    evlogWriteDump().
+
+      evlog_heap [-t] -e writer_elf dump_file
+
+    Replays the allocations and frees. Prints the peak of bytes in use, the
+    blocks still allocated at the end of the log grouped by caller (leaks,
+    or long lived blocks), and the points where the most free space was
+    stranded between live blocks (fragmentation). -t also prints every heap
+    call with bytes in use and stranded after it.
+
+    Sizes are as requested, not as the allocator rounds them. Blocks freed
+    but allocated before the log began are counted as unknown.
+
+    Build, no EVLOG options needed:
+      g++ -O2 -I<dir holding evlog> host/evlog_heap.cpp -o evlog_heap
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "evlog_tools.h"
+
+#define ALLOC_FMT   "EvHeap+ 0x%08X %u, caller 0x%08X"
+#define FREE_FMT    "EvHeap- 0x%08X, caller 0x%08X"
+#define REALLOC_FMT "EvHeap~ 0x%08X to 0x%08X %u, caller 0x%08X"
+
+#define FRAG_PEAKS (5U)
+
+struct Block {
+    uint32_t size;
+    uint32_t caller;
+    uint32_t entry;
+};
+
+struct Sample {
+    uint32_t entry;
+    uint64_t now;
+    uint64_t in_use;
+    uint64_t stranded;
+    size_t blocks;
+};
+
+static EvlogDump dump;
+static EvlogImage image;
+
+static double to_us(uint64_t ticks) {
+    return (0U == dump.header.ts_hz) ? 0.0 : (double)ticks * 1e6 / (double)dump.header.ts_hz;
+}
+
+static std::string caller_name(uint32_t caller) {
+    char buf[64];
+    uint64_t offset = 0;
+    const char *sym = image.symbol_at(caller + dump.header.image_base, &offset);
+    if (NULL == sym) {
+        snprintf(buf, sizeof(buf), "0x%08X", caller);
+        return buf;
+    }
+    snprintf(buf, sizeof(buf), "+0x%X", (unsigned)offset);
+    return std::string(sym) + buf;
+}
+
+int main(int argc, char **argv) {
+    bool timeline = false;
+    const char *exe = NULL;
+    int i = 1;
+    for (; i < argc && '-' == argv[i][0]; i++) {
+        if (0 == strcmp(argv[i], "-t")) {
+            timeline = true;
+        } else if (0 == strcmp(argv[i], "-e") && i + 1 < argc) {
+            exe = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (i + 1 != argc || NULL == exe) {
+        fprintf(stderr, "usage: %s [-t] -e writer_elf dump_file\n", argv[0]);
+        return 2;
+    }
+    if (!dump.open(argv[i])) {
+        fprintf(stderr, "%s: not an EvLog dump\n", argv[i]);
+        return 1;
+    }
+    if (!image.open(exe, dump.header.image_base)) {
+        fprintf(stderr, "%s: can not read the writer image\n", exe);
+        return 1;
+    }
+    if (4U > dump.header.data_count) {
+        fprintf(stderr, "%s: heap records need EVLOG_TOTAL_ARGS of 5\n", argv[i]);
+        return 1;
+    }
+
+    std::map<uint32_t, Block> live;   // By address, ordered for the extent
+    std::vector<Sample> samples;
+    uint64_t in_use = 0;
+    Sample peak = {0, 0, 0, 0, 0};
+    uint32_t calls = 0, failed = 0, unknown = 0;
+    uint64_t now = 0;
+    uint32_t last_ts = 0;
+    for (uint32_t n = 0; n < dump.count(); n++) {
+        EvlogDump::Entry e = dump.entry(n);
+        if (dump.header.has_ts) {
+            now += (0U == n) ? 0U : (uint32_t)(e.ts - last_ts);
+            last_ts = e.ts;
+        }
+        const char *fmt = image.string_at(e.fmt);
+        if (NULL == fmt)
+            continue;
+
+        uint32_t old = 0, ptr = 0, size = 0, caller = 0;
+        char op;
+        if (0 == strcmp(fmt, ALLOC_FMT)) {
+            op = '+';
+            ptr = e.data[0];
+            size = e.data[1];
+            caller = e.data[2];
+        } else if (0 == strcmp(fmt, FREE_FMT)) {
+            op = '-';
+            old = e.data[0];
+            caller = e.data[1];
+        } else if (0 == strcmp(fmt, REALLOC_FMT)) {
+            op = '~';
+            old = e.data[0];
+            ptr = e.data[1];
+            size = e.data[2];
+            caller = e.data[3];
+        } else {
+            continue;
+        }
+        calls++;
+
+        // A failed realloc() leaves the old block in place.
+        if ('-' != op && 0U == ptr && 0U != size) {
+            failed++;
+        } else if (old) {
+            auto it = live.find(old);
+            if (live.end() == it) {
+                unknown++;
+            } else {
+                in_use -= it->second.size;
+                live.erase(it);
+            }
+        }
+        if (ptr) {
+            live[ptr] = Block{size, caller, n};
+            in_use += size;
+        }
+
+        Sample s = {n, now, in_use, 0, live.size()};
+        if (!live.empty()) {
+            auto last = live.rbegin();
+            s.stranded = (uint64_t)last->first + last->second.size - live.begin()->first - in_use;
+        }
+        samples.push_back(s);
+        if (in_use > peak.in_use)
+            peak = s;
+
+        if (timeline) {
+            printf("%8u %14.3f us  %c 0x%08X", n, to_us(now), op, ('-' == op) ? old : ptr);
+            if ('-' != op)
+                printf(" %8u", size);
+            else
+                printf(" %8s", "");
+            printf("  in use %8llu, stranded %8llu  %s\n", (unsigned long long)s.in_use,
+                (unsigned long long)s.stranded, caller_name(caller).c_str());
+        }
+    }
+
+    printf("EvLog Heap: %u calls, %u failed, %u frees of blocks from before the log\n", calls, failed, unknown);
+    if (dump.header.flags & EVLOG_DUMP_F_WRAPPED)
+        printf("Log had wrapped, the oldest records are missing.\n");
+    evlog_print_drops(dump, image);
+    printf("Peak %llu bytes in %zu blocks, at entry %u, %.3f us\n", (unsigned long long)peak.in_use,
+        peak.blocks, peak.entry, to_us(peak.now));
+
+    // Still allocated at the end, by caller.
+    std::map<uint32_t, std::pair<uint32_t, uint64_t>> by_caller;
+    for (const auto& b : live) {
+        auto& c = by_caller[b.second.caller];
+        c.first++;
+        c.second += b.second.size;
+    }
+    printf("Live at end: %llu bytes in %zu blocks\n", (unsigned long long)in_use, live.size());
+    if (!by_caller.empty())
+        printf("%10s %12s  %s\n", "blocks", "bytes", "caller");
+    for (const auto& c : by_caller)
+        printf("%10u %12llu  %s\n", c.second.first, (unsigned long long)c.second.second, caller_name(c.first).c_str());
+
+    // Most free space stranded between live blocks, one per run of rising values.
+    std::vector<Sample> peaks;
+    for (size_t k = 0; k < samples.size(); k++) {
+        bool rising = (0U == k || samples[k].stranded > samples[k - 1U].stranded);
+        bool falls = (samples.size() == k + 1U || samples[k + 1U].stranded < samples[k].stranded);
+        if (rising && falls && 0U != samples[k].stranded)
+            peaks.push_back(samples[k]);
+    }
+    std::sort(peaks.begin(), peaks.end(), [](const Sample& a, const Sample& b) { return a.stranded > b.stranded; });
+    if (peaks.size() > FRAG_PEAKS)
+        peaks.resize(FRAG_PEAKS);
+    printf("Fragmentation peaks, bytes free between live blocks\n");
+    printf("%10s %14s %12s %12s %8s\n", "entry", "us", "stranded", "in use", "blocks");
+    for (const auto& p : peaks) {
+        printf("%10u %14.3f %12llu %12llu %8zu\n", p.entry, to_us(p.now), (unsigned long long)p.stranded,
+            (unsigned long long)p.in_use, p.blocks);
+    }
+    return 0;
+}
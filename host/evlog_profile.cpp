@@ -0,0 +1,279 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Function profile from the evlog_profiler.cpp events in a dump written by
+    evlogWriteDump().
+
+      evlog_profile [-o] [-d depth] -e writer_elf dump_file
+
+    -e is the writer's .elf or executable, it is needed to tell profiler
+    events from others and to name the functions.
+    -o subtracts the logging overhead recorded in the dump, one
+    evlog_get_overhead() per profiler event.
+    -d limits the depth of the printed call tree, default 16.
+
+    Prints a flat profile, by exclusive time, and the call tree with
+    inclusive time. Exits without a matching entry, e.g. from a log that
+    wrapped or a longjmp, are handled by unwinding to the nearest match.
+    Intervals are measured with 32-bit timestamps and must be shorter than
+    their wrap time.
+
+    Build, no EVLOG options needed:
+      g++ -O2 -I<dir holding evlog> host/evlog_profile.cpp -o evlog_profile
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cxxabi.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "evlog_tools.h"
+
+#define ENTER_FMT "EvProf> 0x%08X 0x%08X"
+#define EXIT_FMT  "EvProf< 0x%08X 0x%08X"
+#define MAX_DEPTH (256U)
+
+struct Stats {
+    uint64_t count = 0;
+    uint64_t inclusive = 0;
+    uint64_t exclusive = 0;
+};
+
+struct Node {
+    uint32_t fn;
+    Stats stats;
+    std::map<uint32_t, size_t> children;    // fn to index in nodes
+};
+
+struct Frame {
+    size_t node;
+    uint32_t fn;
+    uint32_t start;
+    uint64_t children;      // Inclusive time of direct children
+    uint32_t direct;        // Direct child calls
+    uint32_t descendants;   // All calls below
+};
+
+static EvlogDump dump;
+static EvlogImage image;
+static std::vector<Node> nodes;
+static std::map<uint32_t, Stats> flat;
+static uint64_t overhead = 0;
+
+static size_t child_of(size_t parent, uint32_t fn) {
+    auto it = nodes[parent].children.find(fn);
+    if (nodes[parent].children.end() != it)
+        return it->second;
+    nodes.push_back(Node{fn, Stats(), {}});
+    nodes[parent].children[fn] = nodes.size() - 1U;
+    return nodes.size() - 1U;
+}
+
+static uint64_t less_overhead(uint64_t t, uint64_t records) {
+    uint64_t o = overhead * records;
+    return (t > o) ? t - o : 0U;
+}
+
+/*
+  Close the top frame at `ts`. Its own enter and exit, less the part of each
+  child's pair that fell outside the child, are taken out of its time.
+*/
+static void pop(std::vector<Frame>& stack, uint32_t ts) {
+    Frame f = stack.back();
+    stack.pop_back();
+    uint64_t inclusive = (uint32_t)(ts - f.start);
+    uint64_t exclusive = (inclusive > f.children) ? inclusive - f.children : 0U;
+    inclusive = less_overhead(inclusive, 1U + 2U * f.descendants);
+    exclusive = less_overhead(exclusive, 1U + f.direct);
+
+    Stats& n = nodes[f.node].stats;
+    n.count++;
+    n.inclusive += inclusive;
+    n.exclusive += exclusive;
+    Stats& s = flat[f.fn];
+    s.count++;
+    s.exclusive += exclusive;
+    // Recursion, count the outermost call only.
+    bool outer = true;
+    for (const Frame& up : stack)
+        outer = outer && up.fn != f.fn;
+    if (outer)
+        s.inclusive += inclusive;
+
+    if (!stack.empty()) {
+        Frame& parent = stack.back();
+        parent.children += (uint32_t)(ts - f.start);
+        parent.direct++;
+        parent.descendants += 1U + f.descendants;
+    }
+}
+
+static std::string name_of(uint32_t fn) {
+    uint64_t offset = 0;
+    const char *sym = image.symbol_at(fn + dump.header.image_base, &offset);
+    char buf[32];
+    if (NULL == sym) {
+        snprintf(buf, sizeof(buf), "0x%08X", fn);
+        return buf;
+    }
+    int status = -1;
+    char *demangled = abi::__cxa_demangle(sym, NULL, NULL, &status);
+    std::string name = (0 == status && demangled) ? demangled : sym;
+    free(demangled);
+    if (offset) {
+        snprintf(buf, sizeof(buf), "+0x%X", (unsigned)offset);
+        name += buf;
+    }
+    return name;
+}
+
+static double to_us(uint64_t ticks) {
+    return (double)ticks * 1e6 / (double)dump.header.ts_hz;
+}
+
+static void print_tree(size_t node, unsigned depth, unsigned max_depth) {
+    const Node& n = nodes[node];
+    if (depth) {
+        if (dump.header.has_ts) {
+            printf("%12.3f %8llu  %*s%s\n", to_us(n.stats.inclusive), (unsigned long long)n.stats.count,
+                (int)(2U * (depth - 1U)), "", name_of(n.fn).c_str());
+        } else {
+            printf("%8llu  %*s%s\n", (unsigned long long)n.stats.count,
+                (int)(2U * (depth - 1U)), "", name_of(n.fn).c_str());
+        }
+    }
+    if (depth >= max_depth)
+        return;
+
+    std::vector<size_t> order;
+    for (const auto& c : n.children)
+        order.push_back(c.second);
+    std::sort(order.begin(), order.end(), [](size_t a, size_t b) {
+        return nodes[a].stats.inclusive > nodes[b].stats.inclusive;
+    });
+    for (size_t c : order)
+        print_tree(c, depth + 1U, max_depth);
+}
+
+int main(int argc, char **argv) {
+    bool subtract = false;
+    unsigned max_depth = 16;
+    const char *exe = NULL;
+    int i = 1;
+    for (; i < argc && '-' == argv[i][0]; i++) {
+        if (0 == strcmp(argv[i], "-o")) {
+            subtract = true;
+        } else if (0 == strcmp(argv[i], "-d") && i + 1 < argc) {
+            max_depth = (unsigned)atoi(argv[++i]);
+        } else if (0 == strcmp(argv[i], "-e") && i + 1 < argc) {
+            exe = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (i + 1 != argc || NULL == exe) {
+        fprintf(stderr, "usage: %s [-o] [-d depth] -e writer_elf dump_file\n", argv[0]);
+        return 2;
+    }
+    if (!dump.open(argv[i])) {
+        fprintf(stderr, "%s: not an EvLog dump\n", argv[i]);
+        return 1;
+    }
+    if (!image.open(exe, dump.header.image_base)) {
+        fprintf(stderr, "%s: can not read the writer image\n", exe);
+        return 1;
+    }
+    if (2U > dump.header.data_count) {
+        fprintf(stderr, "%s: profiling needs EVLOG_TOTAL_ARGS of 3 or more\n", argv[i]);
+        return 1;
+    }
+    if (subtract)
+        overhead = dump.header.overhead;
+
+    nodes.push_back(Node{0, Stats(), {}});
+    std::vector<Frame> stack;
+    uint32_t events = 0, unmatched = 0, last_ts = 0;
+    for (uint32_t n = 0; n < dump.count(); n++) {
+        EvlogDump::Entry e = dump.entry(n);
+        const char *fmt = image.string_at(e.fmt);
+        if (NULL == fmt)
+            continue;
+        bool enter = (0 == strcmp(fmt, ENTER_FMT));
+        if (!enter && 0 != strcmp(fmt, EXIT_FMT))
+            continue;
+
+        events++;
+        last_ts = e.ts;
+        uint32_t fn = e.data[0];
+        if (enter) {
+            if (MAX_DEPTH <= stack.size()) {
+                unmatched++;
+                continue;
+            }
+            size_t parent = (stack.empty()) ? 0U : stack.back().node;
+            stack.push_back(Frame{child_of(parent, fn), fn, e.ts, 0U, 0U, 0U});
+            continue;
+        }
+
+        size_t match = stack.size();
+        while (0 < match && stack[match - 1U].fn != fn)
+            match--;
+        if (0 == match) {
+            unmatched++;    // Entered before the log starts
+            continue;
+        }
+        while (stack.size() >= match)
+            pop(stack, e.ts);
+    }
+    unmatched += (uint32_t)stack.size();
+    while (!stack.empty())
+        pop(stack, last_ts);   // Still running when the log was dumped
+
+    printf("EvLog Profile: %u events, %u unmatched", events, unmatched);
+    if (dump.header.has_ts) {
+        printf(", %u Hz timestamps", dump.header.ts_hz);
+        if (subtract)
+            printf(", %u ticks overhead subtracted per event", dump.header.overhead);
+    }
+    printf("\n");
+    if (dump.header.flags & EVLOG_DUMP_F_WRAPPED)
+        printf("Log had wrapped, the oldest calls are missing.\n");
+    evlog_print_drops(dump, image);
+
+    std::vector<std::pair<uint32_t, Stats>> by_self(flat.begin(), flat.end());
+    std::sort(by_self.begin(), by_self.end(), [](const std::pair<uint32_t, Stats>& a, const std::pair<uint32_t, Stats>& b) {
+        return (a.second.exclusive != b.second.exclusive) ? a.second.exclusive > b.second.exclusive : a.second.count > b.second.count;
+    });
+
+    printf("\nFlat profile:\n");
+    if (dump.header.has_ts) {
+        printf("%12s %12s %8s %10s  %s\n", "self us", "total us", "calls", "us/call", "function");
+        for (const auto& f : by_self) {
+            printf("%12.3f %12.3f %8llu %10.3f  %s\n", to_us(f.second.exclusive), to_us(f.second.inclusive),
+                (unsigned long long)f.second.count, to_us(f.second.inclusive) / (double)f.second.count,
+                name_of(f.first).c_str());
+        }
+        printf("\nCall tree:\n%12s %8s  %s\n", "total us", "calls", "function");
+    } else {
+        printf("%8s  %s\n", "calls", "function");
+        for (const auto& f : by_self)
+            printf("%8llu  %s\n", (unsigned long long)f.second.count, name_of(f.first).c_str());
+        printf("\nCall tree:\n%8s  %s\n", "calls", "function");
+    }
+    print_tree(0, 0, max_depth);
+    return 0;
+}
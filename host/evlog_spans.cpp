@@ -0,0 +1,148 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Spans from the evlog_span.cpp events in a dump written by
+    evlogWriteDump().
+
+      evlog_spans [-q] -e writer_elf dump_file
+
+    Lists each completed span, indented by depth, and the spans begun but
+    not ended in the log. Then, per span name, the count, min, max, mean and
+    total duration. -q prints the totals only.
+
+    Build, no EVLOG options needed:
+      g++ -O2 -I<dir holding evlog> host/evlog_spans.cpp -o evlog_spans
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include "evlog_tools.h"
+
+#define BEGIN_FMT "EvSpan> 0x%08X, name 0x%08X, arg %u"
+#define END_FMT   "EvSpan< 0x%08X, name 0x%08X, arg %u, %u ticks"
+
+struct Totals {
+    uint64_t count = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    uint64_t total = 0;
+};
+
+static EvlogDump dump;
+static EvlogImage image;
+
+static std::string span_name(uint32_t name, uint32_t arg, bool with_arg) {
+    char buf[256];
+    const char *fmt = image.string_at(name + dump.header.image_base);
+    if (NULL == fmt) {
+        snprintf(buf, sizeof(buf), "< ? >, 0x%08X", name);
+    } else if (!with_arg || !evlog_format(buf, sizeof(buf), fmt, &arg, 1U)) {
+        return fmt;
+    }
+    return buf;
+}
+
+static double to_us(uint64_t ticks) {
+    return (0U == dump.header.ts_hz) ? 0.0 : (double)ticks * 1e6 / (double)dump.header.ts_hz;
+}
+
+int main(int argc, char **argv) {
+    bool quiet = false;
+    const char *exe = NULL;
+    int i = 1;
+    for (; i < argc && '-' == argv[i][0]; i++) {
+        if (0 == strcmp(argv[i], "-q")) {
+            quiet = true;
+        } else if (0 == strcmp(argv[i], "-e") && i + 1 < argc) {
+            exe = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (i + 1 != argc || NULL == exe) {
+        fprintf(stderr, "usage: %s [-q] -e writer_elf dump_file\n", argv[0]);
+        return 2;
+    }
+    if (!dump.open(argv[i])) {
+        fprintf(stderr, "%s: not an EvLog dump\n", argv[i]);
+        return 1;
+    }
+    if (!image.open(exe, dump.header.image_base)) {
+        fprintf(stderr, "%s: can not read the writer image\n", exe);
+        return 1;
+    }
+    if (4U > dump.header.data_count) {
+        fprintf(stderr, "%s: spans need EVLOG_TOTAL_ARGS of 5\n", argv[i]);
+        return 1;
+    }
+
+    std::map<uint32_t, Totals> totals;
+    std::map<uint32_t, EvlogDump::Entry> open;     // By span ID
+    uint32_t spans = 0;
+    for (uint32_t n = 0; n < dump.count(); n++) {
+        EvlogDump::Entry e = dump.entry(n);
+        const char *fmt = image.string_at(e.fmt);
+        if (NULL == fmt)
+            continue;
+
+        uint32_t word = e.data[0];
+        uint32_t id = word & 0xFFFFU;
+        uint32_t depth = (word >> 16) & 0xFFU;
+        if (0 == strcmp(fmt, BEGIN_FMT)) {
+            open[id] = e;
+            continue;
+        }
+        if (0 != strcmp(fmt, END_FMT))
+            continue;
+
+        open.erase(id);
+        spans++;
+        uint64_t ticks = e.data[3];
+        Totals& t = totals[e.data[1]];
+        t.count++;
+        t.total += ticks;
+        t.min = (ticks < t.min) ? ticks : t.min;
+        t.max = (ticks > t.max) ? ticks : t.max;
+        if (!quiet) {
+            printf("%12.3f us %*s#%u %s\n", to_us(ticks), (int)(2U * depth), "", id,
+                span_name(e.data[1], e.data[2], true).c_str());
+        }
+    }
+
+    if (!quiet) {
+        for (const auto& o : open) {
+            printf("%12s    %*s#%u %s, not ended\n", "open", (int)(2U * ((o.second.data[0] >> 16) & 0xFFU)), "",
+                o.first, span_name(o.second.data[1], o.second.data[2], true).c_str());
+        }
+    }
+    printf("EvLog Spans: %u completed, %u open", spans, (unsigned)open.size());
+    if (0U == dump.header.ts_hz)
+        printf(", no timestamps in this dump");
+    printf("\n");
+    if (dump.header.flags & EVLOG_DUMP_F_WRAPPED)
+        printf("Log had wrapped, the oldest spans are missing.\n");
+    evlog_print_drops(dump, image);
+
+    printf("%10s %12s %12s %12s %14s  %s\n", "count", "min us", "max us", "mean us", "total us", "span");
+    for (const auto& t : totals) {
+        printf("%10llu %12.3f %12.3f %12.3f %14.3f  %s\n", (unsigned long long)t.second.count,
+            to_us(t.second.min), to_us(t.second.max), to_us(t.second.total) / (double)t.second.count,
+            to_us(t.second.total), span_name(t.first, 0U, false).c_str());
+    }
+    return 0;
+}
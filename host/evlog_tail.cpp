@@ -0,0 +1,141 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Print, or follow, the events of a file mapped log written by a host build
+    that called evlog_host_map_file(). The file is mapped read-only and read in
+    place, the writer may be running, or may have crashed.
+
+      evlog_tail [-f] [-i ms] [-e writer_executable] log_file
+
+    -f follows the log as it grows, polling every -i ms (default 50).
+    Format strings are looked up in the writer's executable, by default
+    /proc/<pid>/exe of the last writer. Without it events print as hex.
+
+    Build with the same EVLOG options as the writer, e.g.:
+      g++ -O2 -DEVLOG_ENABLE -DEVLOG_HOST -I<dir holding evlog> \
+          src/event_logger.cpp src/evlog_host.cpp host/evlog_tail.cpp -o evlog_tail
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include "evlog_tools.h"
+
+static EvlogImage writer_image;
+static bool have_image = false;
+
+static void print_event(uint32_t slot, const evlog_entry_t& event) {
+    printf("  [%4u] ", slot);
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+    uint32_t us = event.ts / clockCyclesPerMicrosecond();
+    printf("%u.%06u: ", us / 1000000U, us % 1000000U);
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
+    printf("%u.%06u: ", event.ts / 1000000U, event.ts % 1000000U);
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    printf("%u.%03u: ", event.ts / 1000U, event.ts % 1000U);
+#endif
+
+    char line[256];
+    const char *fmt = (have_image) ? writer_image.string_at((uintptr_t)event.fmt) : NULL;
+    if (fmt && evlog_format(line, sizeof(line), fmt, event.data, EVLOG_DATA_MAX)) {
+        printf("%s\n", line);
+    } else {
+        printf("< ? >, %p", (const void *)event.fmt);
+        for (size_t i = 0; i < EVLOG_DATA_MAX; i++)
+            printf(", 0x%08X", event.data[i]);
+        printf("\n");
+    }
+}
+
+static void print_slots(uint32_t from, uint32_t to) {
+    for (uint32_t slot = from; slot < to; slot++) {
+        evlog_entry_t event;
+        if (evlog_get_event_at(slot, &event))
+            print_event(slot, event);
+    }
+}
+
+int main(int argc, char **argv) {
+    bool follow = false;
+    unsigned interval_ms = 50;
+    const char *exe = NULL;
+    int i = 1;
+    for (; i < argc && '-' == argv[i][0]; i++) {
+        if (0 == strcmp(argv[i], "-f")) {
+            follow = true;
+        } else if (0 == strcmp(argv[i], "-i") && i + 1 < argc) {
+            interval_ms = (unsigned)atoi(argv[++i]);
+        } else if (0 == strcmp(argv[i], "-e") && i + 1 < argc) {
+            exe = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (i + 1 != argc) {
+        fprintf(stderr, "usage: %s [-f] [-i ms] [-e writer_executable] log_file\n", argv[0]);
+        return 2;
+    }
+
+    const evlog_host_file_t *hdr = evlog_host_map_file(argv[i], false);
+    if (NULL == hdr) {
+        fprintf(stderr, "%s: not an EvLog file for this build (EVLOG_HOST_RESERVE_SIZE %u, entry %u bytes)\n",
+            argv[i], (unsigned)EVLOG_HOST_RESERVE_SIZE, (unsigned)sizeof(evlog_entry_t));
+        return 1;
+    }
+
+    char proc_exe[32];
+    if (NULL == exe) {
+        snprintf(proc_exe, sizeof(proc_exe), "/proc/%u/exe", hdr->pid);
+        exe = proc_exe;
+    }
+    have_image = writer_image.open(exe, hdr->image_base);
+    if (!have_image)
+        fprintf(stderr, "%s: writer image not available, printing raw events\n", exe);
+
+    if (!evlog_is_inited()) {
+        printf("EvLog not inited\n");
+        if (!follow)
+            return 0;
+    }
+
+    bool wrapped = false;
+    uint32_t max = evlog_get_max_events();
+    uint32_t num = evlog_get_num(&wrapped);
+    if (wrapped && num < max)
+        print_slots(num, max);
+    print_slots(0, num);
+
+    while (follow) {
+        fflush(stdout);
+        struct timespec delay = { (time_t)(interval_ms / 1000U), (long)(interval_ms % 1000U) * 1000000L };
+        nanosleep(&delay, NULL);
+
+        bool now_wrapped = false;
+        uint32_t now = evlog_get_num(&now_wrapped);
+        if (now > num) {
+            print_slots(num, now);
+        } else if (now < num) {
+            if (now_wrapped) {
+                print_slots(num, max);
+            } else {
+                printf("--- EvLog restarted ---\n");
+            }
+            print_slots(0, now);
+        }
+        num = now;
+    }
+    return 0;
+}
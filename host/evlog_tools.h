@@ -0,0 +1,363 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Helpers shared by the host tools that read a log written by another
+    process or device.
+
+    The `fmt` pointers in such a log are addresses in the writer's image. An
+    `EvlogImage` maps the writer's ELF file and finds the string at a
+    runtime address, given the writer's load base, and names the function
+    holding a code address. An `EvlogDump` reads a file written by
+    evlogWriteDump().
+*/
+#ifndef EVLOG_TOOLS_H
+#define EVLOG_TOOLS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+#include <evlog/src/evlog_dump.h>
+
+class EvlogImage {
+public:
+    ~EvlogImage() {
+        if (image)
+            munmap((void *)image, size);
+    }
+
+    /*
+      `runtime_base` is where the writer had `__executable_start`. Use 0 for
+      an ESP8266 .elf, its addresses are absolute.
+    */
+    bool open(const char *path, uint64_t runtime_base) {
+        int fd = ::open(path, O_RDONLY);
+        if (0 > fd)
+            return false;
+
+        struct stat st;
+        if (0 == fstat(fd, &st) && sizeof(Elf32_Ehdr) <= (size_t)st.st_size) {
+            size = (size_t)st.st_size;
+            void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            image = (MAP_FAILED == p) ? NULL : (const uint8_t *)p;
+        }
+        ::close(fd);
+        if (NULL == image || 0 != memcmp(image, ELFMAG, SELFMAG))
+            return false;
+
+        elf64 = (ELFCLASS64 == image[EI_CLASS]);
+        link_base = UINT64_MAX;
+        for (size_t i = 0; i < phnum(); i++) {
+            Elf64_Phdr ph;
+            if (phdr(i, &ph) && PT_LOAD == ph.p_type && ph.p_vaddr < link_base)
+                link_base = ph.p_vaddr;
+        }
+        if (UINT64_MAX == link_base)
+            return false;
+
+        bias = (0 == runtime_base) ? 0 : link_base - runtime_base;
+        return true;
+    }
+
+    /*
+      The NUL terminated string at `addr` in the writer, or NULL when it is
+      not in a loaded part of the image.
+    */
+    const char *string_at(uint64_t addr) const {
+        if (NULL == image || 0 == addr)
+            return NULL;
+
+        uint64_t vaddr = addr + bias;
+        for (size_t i = 0; i < phnum(); i++) {
+            Elf64_Phdr ph;
+            if (!phdr(i, &ph) || PT_LOAD != ph.p_type)
+                continue;
+
+            if (ph.p_vaddr <= vaddr && vaddr < ph.p_vaddr + ph.p_filesz) {
+                uint64_t off = ph.p_offset + (vaddr - ph.p_vaddr);
+                const char *s = (const char *)image + off;
+                if (off < size && NULL != memchr(s, 0, size - off))
+                    return s;
+                return NULL;
+            }
+        }
+        return NULL;
+    }
+
+    /*
+      The name of the function holding code address `addr` in the writer, or
+      NULL when the image has no symbol for it. `offset` gets the distance
+      from the start of the function.
+    */
+    const char *symbol_at(uint64_t addr, uint64_t *offset = NULL) {
+        if (NULL == image)
+            return NULL;
+        if (!symbols_loaded)
+            load_symbols();
+
+        uint64_t vaddr = addr + bias;
+        auto it = std::upper_bound(symbols.begin(), symbols.end(), vaddr,
+            [](uint64_t a, const Symbol& sym) { return a < sym.value; });
+        if (symbols.begin() == it)
+            return NULL;
+        --it;
+        if (vaddr >= it->value + ((0 == it->size) ? 1U : it->size))
+            return NULL;
+        if (offset)
+            *offset = vaddr - it->value;
+        return it->name;
+    }
+
+private:
+    struct Symbol {
+        uint64_t value;
+        uint64_t size;
+        const char *name;
+    };
+
+    void load_symbols(void) {
+        symbols_loaded = true;
+        size_t shnum = (elf64) ? ((const Elf64_Ehdr *)image)->e_shnum : ((const Elf32_Ehdr *)image)->e_shnum;
+        for (size_t i = 0; i < shnum; i++) {
+            Elf64_Shdr sh, strtab;
+            if (!shdr(i, &sh) || (SHT_SYMTAB != sh.sh_type && SHT_DYNSYM != sh.sh_type))
+                continue;
+            if (!shdr(sh.sh_link, &strtab) || strtab.sh_offset + strtab.sh_size > size)
+                continue;
+
+            size_t entsize = (elf64) ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+            for (uint64_t off = sh.sh_offset; off + entsize <= sh.sh_offset + sh.sh_size && off + entsize <= size; off += entsize) {
+                Symbol sym;
+                uint32_t name;
+                unsigned char info;
+                if (elf64) {
+                    const Elf64_Sym *s = (const Elf64_Sym *)(image + off);
+                    name = s->st_name, info = s->st_info, sym.value = s->st_value, sym.size = s->st_size;
+                } else {
+                    const Elf32_Sym *s = (const Elf32_Sym *)(image + off);
+                    name = s->st_name, info = s->st_info, sym.value = s->st_value, sym.size = s->st_size;
+                }
+                if (STT_FUNC != ELF64_ST_TYPE(info) || 0 == sym.value || name >= strtab.sh_size)
+                    continue;
+                sym.name = (const char *)image + strtab.sh_offset + name;
+                if (NULL == memchr(sym.name, 0, strtab.sh_size - name))
+                    continue;
+                symbols.push_back(sym);
+            }
+        }
+        std::sort(symbols.begin(), symbols.end(),
+            [](const Symbol& a, const Symbol& b) { return a.value < b.value; });
+    }
+
+    bool shdr(size_t i, Elf64_Shdr *sh) const {
+        if (elf64) {
+            const Elf64_Ehdr *eh = (const Elf64_Ehdr *)image;
+            uint64_t off = eh->e_shoff + i * eh->e_shentsize;
+            if (0 == eh->e_shoff || off + sizeof(Elf64_Shdr) > size)
+                return false;
+            memcpy(sh, image + off, sizeof(Elf64_Shdr));
+        } else {
+            const Elf32_Ehdr *eh = (const Elf32_Ehdr *)image;
+            uint64_t off = eh->e_shoff + i * eh->e_shentsize;
+            if (0 == eh->e_shoff || off + sizeof(Elf32_Shdr) > size)
+                return false;
+            Elf32_Shdr sh32;
+            memcpy(&sh32, image + off, sizeof(sh32));
+            sh->sh_type = sh32.sh_type;
+            sh->sh_offset = sh32.sh_offset;
+            sh->sh_size = sh32.sh_size;
+            sh->sh_link = sh32.sh_link;
+        }
+        return true;
+    }
+
+    size_t phnum(void) const {
+        return (elf64) ? ((const Elf64_Ehdr *)image)->e_phnum : ((const Elf32_Ehdr *)image)->e_phnum;
+    }
+
+    bool phdr(size_t i, Elf64_Phdr *ph) const {
+        if (elf64) {
+            const Elf64_Ehdr *eh = (const Elf64_Ehdr *)image;
+            uint64_t off = eh->e_phoff + i * eh->e_phentsize;
+            if (off + sizeof(Elf64_Phdr) > size)
+                return false;
+            memcpy(ph, image + off, sizeof(Elf64_Phdr));
+        } else {
+            const Elf32_Ehdr *eh = (const Elf32_Ehdr *)image;
+            uint64_t off = eh->e_phoff + i * eh->e_phentsize;
+            if (off + sizeof(Elf32_Phdr) > size)
+                return false;
+            Elf32_Phdr ph32;
+            memcpy(&ph32, image + off, sizeof(ph32));
+            ph->p_type = ph32.p_type;
+            ph->p_offset = ph32.p_offset;
+            ph->p_vaddr = ph32.p_vaddr;
+            ph->p_filesz = ph32.p_filesz;
+        }
+        return true;
+    }
+
+    const uint8_t *image = NULL;
+    size_t size = 0;
+    bool elf64 = false;
+    uint64_t link_base = 0;
+    uint64_t bias = 0;
+    bool symbols_loaded = false;
+    std::vector<Symbol> symbols;
+};
+
+/*
+  A dump file from evlogWriteDump(), read whole. `fmt` addresses of entries
+  come back as the writer's runtime addresses, ready for
+  EvlogImage::string_at() with `header.image_base`.
+*/
+class EvlogDump {
+public:
+    struct Entry {
+        uint64_t fmt;
+        const uint32_t *data;   // header.data_count words
+        uint32_t ts;            // 0 without has_ts
+    };
+
+    evlog_dump_header_t header;
+
+    bool open(const char *path) {
+        FILE *f = fopen(path, "rb");
+        if (NULL == f)
+            return false;
+        uint8_t buf[4096];
+        size_t n;
+        while (0 < (n = fread(buf, 1, sizeof(buf), f)))
+            file.insert(file.end(), buf, buf + n);
+        fclose(f);
+
+        if (sizeof(header) > file.size())
+            return false;
+        memcpy(&header, file.data(), sizeof(header));
+        if (EVLOG_DUMP_MAGIC != header.magic || EVLOG_DUMP_VERSION != header.version)
+            return false;
+
+        entry_words = 1U + header.data_count + ((header.has_ts) ? 1U : 0U);
+        sections = sizeof(header) + (size_t)header.count * entry_words * sizeof(uint32_t);
+        return sections <= file.size();
+    }
+
+    uint32_t count(void) const {
+        return header.count;
+    }
+
+    Entry entry(uint32_t i) const {
+        const uint32_t *w = (const uint32_t *)(file.data() + sizeof(header)) + (size_t)i * entry_words;
+        Entry e;
+        e.fmt = (0 == w[0]) ? 0U : w[0] + header.image_base;
+        e.data = &w[1];
+        e.ts = (header.has_ts) ? w[1 + header.data_count] : 0U;
+        return e;
+    }
+
+    /*
+      The payload of the first section with `tag`, NULL when there is none.
+    */
+    const uint8_t *section(uint32_t tag, uint32_t *length) const {
+        size_t off = sections;
+        while (off + sizeof(evlog_dump_section_t) <= file.size()) {
+            evlog_dump_section_t sec;
+            memcpy(&sec, file.data() + off, sizeof(sec));
+            off += sizeof(sec);
+            if (EVLOG_DUMP_TAG_END == sec.tag || off + sec.length > file.size())
+                break;
+            if (tag == sec.tag) {
+                if (length)
+                    *length = sec.length;
+                return file.data() + off;
+            }
+            off += (sec.length + 3U) & ~3U;
+        }
+        return NULL;
+    }
+
+private:
+    std::vector<uint8_t> file;
+    size_t entry_words = 0;
+    size_t sections = 0;
+};
+
+/*
+  The EVLOG_DUMP_TAG_DROPS section as lines on stdout, nothing when no
+  events were lost. The first loss is in timestamp ticks, it wraps with them.
+*/
+static inline void evlog_print_drops(const EvlogDump& dump, const EvlogImage& image) {
+    uint32_t length = 0;
+    const uint8_t *p = dump.section(EVLOG_DUMP_TAG_DROPS, &length);
+    if (NULL == p || EVLOG_DUMP_DROPS_WORDS * sizeof(uint32_t) > length)
+        return;
+
+    std::vector<uint32_t> w(length / sizeof(uint32_t));
+    memcpy(w.data(), p, w.size() * sizeof(uint32_t));
+    if (0U == w[0] && 0U == w[1])
+        return;
+
+    printf("Lost %u events, %u dropped with the log full, %u overwritten", w[0] + w[1], w[0], w[1]);
+    if (dump.header.has_ts)
+        printf(", first at ts 0x%08X", w[2]);
+    printf("\n");
+    for (size_t i = 0; i < w[4] && EVLOG_DUMP_DROPS_WORDS + 2U * i + 1U < w.size(); i++) {
+        uint32_t offset = w[EVLOG_DUMP_DROPS_WORDS + 2U * i];
+        const char *fmt = image.string_at(offset + dump.header.image_base);
+        printf("%10u  %s\n", w[EVLOG_DUMP_DROPS_WORDS + 2U * i + 1U], (fmt) ? fmt : "< ? >");
+    }
+    if (w[3])
+        printf("%10u  other\n", w[3]);
+}
+
+/*
+  printf an EvLog format string with its data words into `buf`. Only
+  integer and character conversions are allowed, no more than `count` of
+  them. Anything else, like %s, could follow a data word as a pointer.
+  Returns false, with `buf` untouched, when `fmt` is not safe.
+*/
+static inline bool evlog_format(char *buf, size_t buf_size, const char *fmt, const uint32_t *data, size_t count) {
+    size_t used = 0;
+    for (const char *p = fmt; *p; p++) {
+        if ('%' != *p)
+            continue;
+        p++;
+        if ('%' == *p)
+            continue;
+        p += strspn(p, "-+ #0123456789.");
+        p += strspn(p, "h");
+        if ('\0' == *p || NULL == strchr("diouxXc", *p) || ++used > count)
+            return false;
+    }
+
+    uint32_t d[5] = {0, 0, 0, 0, 0};
+    memcpy(d, data, ((count < 5U) ? count : 5U) * sizeof(uint32_t));
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+    snprintf(buf, buf_size, fmt, d[0], d[1], d[2], d[3], d[4]);
+#pragma GCC diagnostic pop
+    return true;
+}
+
+#endif // EVLOG_TOOLS_H
@@ -0,0 +1,185 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Chrome trace event JSON from a dump written by evlogWriteDump(), for
+    chrome://tracing or ui.perfetto.dev. Same mapping as
+    evlogWriteChromeTrace(), see evlog_trace.h, with profiler functions
+    named from the writer's symbols.
+
+      evlog_trace -e writer_elf dump_file > trace.json
+
+    Build, no EVLOG options needed:
+      g++ -O2 -I<dir holding evlog> host/evlog_trace.cpp -o evlog_trace
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cxxabi.h>
+#include <string>
+#include "evlog_tools.h"
+
+#define COUNTER_PREFIX "Cnt "
+#define SPAN_BEGIN_FMT "EvSpan> 0x%08X, name 0x%08X, arg %u"
+#define SPAN_END_FMT   "EvSpan< 0x%08X, name 0x%08X, arg %u, %u ticks"
+#define PROF_ENTER_FMT "EvProf> 0x%08X 0x%08X"
+#define PROF_EXIT_FMT  "EvProf< 0x%08X 0x%08X"
+#define CLOCK_FMT      "EvClock %u.%06u UTC"
+
+static EvlogDump dump;
+static EvlogImage image;
+static bool first = true;
+static double utc_offset_us = 0.0;   // From the last clock record
+
+static std::string json_string(const std::string& s) {
+    std::string j = "\"";
+    for (char c : s) {
+        char buf[8];
+        if ('"' == c || '\\' == c) {
+            j += '\\';
+            j += c;
+        } else if ((unsigned char)c < 0x20U) {
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+            j += buf;
+        } else {
+            j += c;
+        }
+    }
+    return j + "\"";
+}
+
+static double to_us(uint64_t ticks) {
+    if (0U == dump.header.ts_hz)
+        return (double)ticks;   // Event index
+    return (double)ticks * 1e6 / (double)dump.header.ts_hz;
+}
+
+static void event(const char *ph, uint64_t ts, const std::string& name, const char *extra = "") {
+    printf("%s{\"pid\":1,\"tid\":1,\"ph\":\"%s\",\"ts\":%.3f,\"name\":%s%s}", (first) ? "" : ",\n",
+        ph, to_us(ts) + utc_offset_us, json_string(name).c_str(), extra);
+    first = false;
+}
+
+static std::string function_name(uint32_t fn) {
+    char buf[32];
+    const char *sym = image.symbol_at(fn + dump.header.image_base);
+    if (NULL == sym) {
+        snprintf(buf, sizeof(buf), "0x%08X", fn);
+        return buf;
+    }
+    int status = -1;
+    char *demangled = abi::__cxa_demangle(sym, NULL, NULL, &status);
+    std::string name = (0 == status && demangled) ? demangled : sym;
+    free(demangled);
+    return name;
+}
+
+int main(int argc, char **argv) {
+    const char *exe = NULL;
+    int i = 1;
+    for (; i < argc && '-' == argv[i][0]; i++) {
+        if (0 == strcmp(argv[i], "-e") && i + 1 < argc) {
+            exe = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (i + 1 != argc || NULL == exe) {
+        fprintf(stderr, "usage: %s -e writer_elf dump_file\n", argv[0]);
+        return 2;
+    }
+    if (!dump.open(argv[i])) {
+        fprintf(stderr, "%s: not an EvLog dump\n", argv[i]);
+        return 1;
+    }
+    if (!image.open(exe, dump.header.image_base)) {
+        fprintf(stderr, "%s: can not read the writer image\n", exe);
+        return 1;
+    }
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    event("M", 0, "process_name", ",\"args\":{\"name\":\"EvLog\"}");
+    uint64_t now = 0;
+    uint32_t last_ts = 0;
+    uint32_t data[5] = {0, 0, 0, 0, 0};
+    size_t data_count = (dump.header.data_count < 5U) ? dump.header.data_count : 5U;
+    bool wall_clock = dump.header.has_ts && 0U != dump.header.ts_hz && 2U <= data_count;
+
+    // Events before the first clock record are placed back from it.
+    for (uint32_t n = 0; wall_clock && n < dump.count(); n++) {
+        EvlogDump::Entry e = dump.entry(n);
+        const char *fmt = image.string_at(e.fmt);
+        now += (0U == n) ? 0U : (uint32_t)(e.ts - last_ts);
+        last_ts = e.ts;
+        if (fmt && 0 == strcmp(fmt, CLOCK_FMT)) {
+            utc_offset_us = (double)e.data[0] * 1e6 + (double)e.data[1] - to_us(now);
+            break;
+        }
+    }
+    now = 0;
+    last_ts = 0;
+
+    for (uint32_t n = 0; n < dump.count(); n++) {
+        EvlogDump::Entry e = dump.entry(n);
+        if (dump.header.has_ts) {
+            now += (0U == n) ? 0U : (uint32_t)(e.ts - last_ts);
+            last_ts = e.ts;
+        } else {
+            now = n;
+        }
+        memcpy(data, e.data, data_count * sizeof(uint32_t));
+
+        char text[256];
+        const char *fmt = image.string_at(e.fmt);
+        if (wall_clock && fmt && 0 == strcmp(fmt, CLOCK_FMT))
+            utc_offset_us = (double)data[0] * 1e6 + (double)data[1] - to_us(now);
+        if (NULL == fmt) {
+            snprintf(text, sizeof(text), "< ? > 0x%08X", (uint32_t)(e.fmt - dump.header.image_base));
+            event("i", now, text, ",\"s\":\"t\"");
+            continue;
+        }
+        if (0 == strcmp(fmt, SPAN_BEGIN_FMT))
+            continue;
+
+        if (0 == strcmp(fmt, SPAN_END_FMT)) {
+            const char *name = image.string_at(data[1] + dump.header.image_base);
+            if (NULL == name || !evlog_format(text, sizeof(text), name, &data[2], 1U))
+                snprintf(text, sizeof(text), "%s", (name) ? name : "< ? >");
+            char extra[96];
+            snprintf(extra, sizeof(extra), ",\"dur\":%.3f,\"args\":{\"id\":%u,\"depth\":%u}",
+                to_us(data[3]), data[0] & 0xFFFFU, (data[0] >> 16) & 0xFFU);
+            event("X", (now > data[3]) ? now - data[3] : 0U, text, extra);
+            continue;
+        }
+        bool enter = (0 == strcmp(fmt, PROF_ENTER_FMT));
+        if (enter || 0 == strcmp(fmt, PROF_EXIT_FMT)) {
+            event((enter) ? "B" : "E", now, function_name(data[0]));
+            continue;
+        }
+        if (0 == strncmp(fmt, COUNTER_PREFIX, strlen(COUNTER_PREFIX))) {
+            std::string name = fmt + strlen(COUNTER_PREFIX);
+            name = name.substr(0, name.find(' '));
+            char extra[48];
+            snprintf(extra, sizeof(extra), ",\"args\":{\"value\":%u}", data[0]);
+            event("C", now, name, extra);
+            continue;
+        }
+        if (!evlog_format(text, sizeof(text), fmt, data, data_count))
+            snprintf(text, sizeof(text), "%s", fmt);
+        event("i", now, text, ",\"s\":\"t\"");
+    }
+    printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Turn the output of evlogWriteCompressed() back into a plain dump, as
+    evlogWriteDump() would have written it, for the other host tools.
+
+      evlog_unpack packed_file dump_file
+
+    Build, no EVLOG options needed:
+      g++ -O2 -I<dir holding evlog> host/evlog_unpack.cpp -o evlog_unpack
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <evlog/src/evlog_dump.h>
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool read_file(const char *path, Bytes& bytes) {
+    FILE *f = fopen(path, "rb");
+    if (NULL == f)
+        return false;
+    uint8_t buf[4096];
+    size_t n;
+    while (0 < (n = fread(buf, 1, sizeof(buf), f)))
+        bytes.insert(bytes.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static bool unlz(const uint8_t *p, const uint8_t *end, Bytes& out) {
+    while (p < end) {
+        uint8_t c = *p++;
+        if (0U == (c & 0x80U)) {
+            size_t n = c + 1U;
+            if ((size_t)(end - p) < n)
+                return false;
+            out.insert(out.end(), p, p + n);
+            p += n;
+        } else {
+            if (p == end)
+                return false;
+            size_t n = (c & 0x7FU) + EVLOG_PACK_LZ_MIN;
+            size_t dist = *p++ + 1U;
+            if (dist > out.size())
+                return false;
+            for (size_t i = 0; i < n; i++)
+                out.push_back(out[out.size() - dist]);
+        }
+    }
+    return true;
+}
+
+class Reader {
+public:
+    Reader(const Bytes& bytes) : p(bytes.data()), end(bytes.data() + bytes.size()) {}
+
+    bool varint(uint32_t *value) {
+        uint32_t v = 0;
+        for (unsigned shift = 0; shift < 35U; shift += 7U) {
+            if (p == end)
+                return false;
+            uint8_t c = *p++;
+            v |= (uint32_t)(c & 0x7FU) << shift;
+            if (0U == (c & 0x80U)) {
+                *value = v;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const uint8_t *p;
+    const uint8_t *end;
+};
+
+int main(int argc, char **argv) {
+    if (3 != argc) {
+        fprintf(stderr, "usage: %s packed_file dump_file\n", argv[0]);
+        return 2;
+    }
+
+    Bytes packed;
+    evlog_dump_header_t hdr;
+    if (!read_file(argv[1], packed) || sizeof(hdr) > packed.size()) {
+        fprintf(stderr, "%s: can not read\n", argv[1]);
+        return 1;
+    }
+    memcpy(&hdr, packed.data(), sizeof(hdr));
+    if (EVLOG_PACK_MAGIC != hdr.magic || EVLOG_DUMP_VERSION != hdr.version) {
+        fprintf(stderr, "%s: not a packed EvLog dump\n", argv[1]);
+        return 1;
+    }
+
+    Bytes body;
+    if (hdr.flags & EVLOG_DUMP_F_LZ) {
+        if (!unlz(packed.data() + sizeof(hdr), packed.data() + packed.size(), body)) {
+            fprintf(stderr, "%s: bad LZ data\n", argv[1]);
+            return 1;
+        }
+    } else {
+        body.assign(packed.begin() + sizeof(hdr), packed.end());
+    }
+
+    Bytes dump;
+    hdr.magic = EVLOG_DUMP_MAGIC;
+    hdr.flags &= ~EVLOG_DUMP_F_LZ;
+    dump.insert(dump.end(), (const uint8_t *)&hdr, (const uint8_t *)&hdr + sizeof(hdr));
+
+    Reader in(body);
+    std::vector<uint32_t> dict;
+    uint32_t ts = 0;
+    for (uint32_t n = 0; n < hdr.count; n++) {
+        uint32_t words[1U + 255U + 1U];
+        size_t w = 0;
+        uint32_t code, value;
+        bool ok = in.varint(&code);
+        if (ok && 0U == code) {
+            ok = in.varint(&value);
+            dict.push_back(value);
+            words[w++] = value;
+        } else if (ok && code <= dict.size()) {
+            words[w++] = dict[code - 1U];
+        } else {
+            ok = false;
+        }
+        if (ok && hdr.has_ts) {
+            ok = in.varint(&value);
+            ts += value;
+        }
+        for (size_t d = 0; ok && d < hdr.data_count; d++) {
+            ok = in.varint(&value);
+            words[w++] = (value >> 1) ^ (uint32_t)-(int32_t)(value & 1U);
+        }
+        if (!ok) {
+            fprintf(stderr, "%s: truncated at entry %u of %u\n", argv[1], n, hdr.count);
+            return 1;
+        }
+        if (hdr.has_ts)
+            words[w++] = ts;
+        dump.insert(dump.end(), (const uint8_t *)words, (const uint8_t *)&words[w]);
+    }
+    // Sections are passed through as they are.
+    dump.insert(dump.end(), in.p, in.end);
+
+    FILE *f = fopen(argv[2], "wb");
+    if (NULL == f || dump.size() != fwrite(dump.data(), 1, dump.size(), f)) {
+        fprintf(stderr, "%s: can not write\n", argv[2]);
+        return 1;
+    }
+    fclose(f);
+    fprintf(stderr, "%u entries, %zu bytes from %zu, %.1fx\n", hdr.count, dump.size(), packed.size(),
+        (double)dump.size() / (double)packed.size());
+    return 0;
+}
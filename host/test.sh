@@ -0,0 +1,98 @@
+#!/bin/sh
+#
+# Build and run the EvLog host tests, host/test/test_*.cpp. Each test is
+# linked with the modules that build on the host, once per configuration,
+# and fails by exiting non-zero.
+#
+#   host/test.sh                all tests
+#   host/test.sh NAME...        only host/test/test_NAME.cpp
+#
+# CXX and CXXFLAGS are honored. BUILD_DIR defaults to /tmp/evlog-test.
+#
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${BUILD_DIR:-/tmp/evlog-test}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -Wall -Wextra}
+MODULES="event_logger evlog_host evlog_dump evlog_profiler evlog_span evlog_stats evlog_trace evlog_rtc evlog_query evlog_sample evlog_boot"
+# Built with the others, linked only by the tests that ask, see test_links().
+OPT_MODULES="evlog_heap"
+
+# Sources include <evlog/src/...>, as installed in an Arduino library folder.
+mkdir -p "$BUILD_DIR/include"
+ln -sfn "$ROOT" "$BUILD_DIR/include/evlog"
+
+config_defs() {
+  defs="-DEVLOG_ENABLE -DEVLOG_HOST"
+  case $1 in circular*) defs="$defs -DEVLOG_CIRCULAR" ;; esac
+  case $1 in *+salvage) defs="$defs -DEVLOG_SALVAGE" ;; esac
+  case $1 in *+rtcdelta) defs="$defs -DEVLOG_RTC_TS_DELTA" ;; esac
+  case $1 in *+qindex) defs="$defs -DEVLOG_QUERY_INDEX=2" ;; esac
+  echo "$defs"
+}
+
+# The module objects of configuration $1, built once a run.
+BUILT=
+FAILED=0
+build_config() {
+  case " $BUILT " in *" $1 "*) return 0 ;; esac
+  dir="$BUILD_DIR/$1"
+  mkdir -p "$dir"
+  for m in $MODULES $OPT_MODULES; do
+    $CXX $CXXFLAGS $(config_defs "$1") -I"$BUILD_DIR/include" -c -o "$dir/$m.o" "$ROOT/src/$m.cpp"
+  done
+  BUILT="$BUILT $1"
+  # evlog_preinit() may run before the C++ constructors, the default log
+  # must not have one.
+  if objdump -h "$dir/event_logger.o" | grep -qE '\.init_array|\.ctors'; then
+    echo "FAIL event_logger.o has a constructor ($1)"
+    FAILED=1
+  fi
+}
+
+# Extra objects and link options of test $1, objects in $2.
+test_links() {
+  case $1 in
+    heap) echo "$2/evlog_heap.o -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free" ;;
+  esac
+}
+
+configs() {
+  case $1 in
+    salvage) echo "linear+salvage circular+salvage" ;;
+    drops) echo "linear linear+salvage" ;;
+    rtc) echo "linear linear+rtcdelta" ;;
+    query) echo "linear+qindex circular+qindex" ;;
+    *) echo "linear circular" ;;
+  esac
+}
+
+# The host tools a test runs, no EVLOG options needed.
+for tool in evlog_unpack; do
+  $CXX $CXXFLAGS -I"$BUILD_DIR/include" -o "$BUILD_DIR/$tool" "$ROOT/host/$tool.cpp"
+done
+
+if [ $# -eq 0 ]; then
+  set -- $(cd "$ROOT/host/test" && ls test_*.cpp | sed 's/^test_//; s/\.cpp$//')
+fi
+
+for name in "$@"; do
+  for config in $(configs "$name"); do
+    build_config "$config"
+    dir="$BUILD_DIR/$config"
+    exe="$dir/test_$name"
+    objs=
+    for m in $MODULES; do objs="$objs $dir/$m.o"; done
+    $CXX $CXXFLAGS $(config_defs "$config") -I"$BUILD_DIR/include" -o "$exe" \
+      "$ROOT/host/test/test_$name.cpp" $objs $(test_links "$name" "$dir") -Wl,-T,"$ROOT/host/test/noinit.ld"
+    if (cd "$dir" && "$exe" "$BUILD_DIR" > "$exe.out" 2>&1); then
+      echo "PASS $name ($config)"
+    else
+      echo "FAIL $name ($config)"
+      cat "$exe.out"
+      FAILED=1
+    fi
+  done
+done
+exit $FAILED
@@ -0,0 +1,46 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Checks for the host tests, see host/test.sh. A failed check prints where
+  and carries on, main() returns evlog_test_result().
+*/
+#ifndef EVLOG_TEST_H
+#define EVLOG_TEST_H
+
+#include <stdio.h>
+
+static int evlog_test_failures = 0;
+
+#define CHECK(cond) do{ \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      evlog_test_failures++; \
+    } \
+  }while(false)
+
+#define CHECK_EQ(a, b) do{ \
+    unsigned long long _a = (unsigned long long)(a), _b = (unsigned long long)(b); \
+    if (_a != _b) { \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed, %llu != %llu\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+      evlog_test_failures++; \
+    } \
+  }while(false)
+
+static inline int evlog_test_result(void) {
+  return (evlog_test_failures) ? 1 : 0;
+}
+
+#endif // EVLOG_TEST_H
@@ -0,0 +1,86 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  The app_entry_redefinable() of evlog_main.cpp, before the C++ constructors
+  and before the SDK clears .bss. Both are done here in that order, with
+  .bss cleared to the start of .noinit, see noinit.ld. The events and boot
+  marks made early must all be there in main(), standing in for user_init().
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_boot.h>
+#include <string.h>
+#include "evlog_test.h"
+
+extern char __sdk_bss_start[];
+extern char __sdk_bss_end[];
+
+// Not in .bss, it would be cleared with it.
+static uint32_t early_count = ~0U;
+static bool bss_cleared = false;
+
+static const char *early_fmt[] = {
+  "*** app_entry_redefinable()",
+  "flashchip->chip_size, %d",
+  "*** call_user_start() - NONOS SDK",
+};
+
+__attribute__((constructor(101)))
+static void app_entry(void) {
+  evlog_preinit(1);
+  EVLOG1_P(early_fmt[0]);
+  EVLOG2_P(early_fmt[1], 4 * 1024 * 1024);
+  evlog_boot_begin();
+  EVLOG1_P(early_fmt[2]);
+  evlog_boot_mark(EVLOG_BOOT_SDK_START);
+  early_count = evlog_get_count();
+}
+
+__attribute__((constructor(102)))
+static void sdk_clear_bss(void) {
+  memset(__sdk_bss_start, 0, __sdk_bss_end - __sdk_bss_start);
+  bss_cleared = true;
+}
+
+int main() {
+  CHECK(bss_cleared);
+  evlog_boot_mark(EVLOG_BOOT_USER_INIT);
+
+  // "Inited", the three events and two boot milestones, each logged.
+  CHECK_EQ(early_count, 6U);
+  CHECK(evlog_is_inited());
+  CHECK(evlog_is_enable());
+  CHECK_EQ(evlog_get_count(), early_count + 1U);
+
+  evlog_entry_t entry;
+  uint32_t n = 0;
+  const char *fmts[8] = {NULL};
+  bool more = true;
+  while (more && n < 8U) {
+    memset(&entry, 0, sizeof(entry));
+    more = evlog_get_event(&entry, 0U == n);
+    fmts[n++] = entry.fmt;
+  }
+  CHECK_EQ(n, 7U);
+  CHECK(fmts[1] == early_fmt[0]);
+  CHECK(fmts[2] == early_fmt[1]);
+  CHECK(fmts[4] == early_fmt[2]);
+
+  evlog_boot_record_t record;
+  CHECK_EQ(evlog_boot_get(0, &record), 1U);
+  CHECK_EQ(record.marked, (1U << EVLOG_BOOT_APP_ENTRY) | (1U << EVLOG_BOOT_SDK_START) | (1U << EVLOG_BOOT_USER_INIT));
+  return evlog_test_result();
+}
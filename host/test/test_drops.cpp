@@ -0,0 +1,96 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Drop counts are kept with the log. A new EventLog over the same memory,
+  resumed as after a reset under EVLOG_NOZERO_COOKIE, must see those of the
+  one before. evlog_calibrate() must leave the default log's counts as they
+  were, and clearing must zero them.
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_instance.h>
+#include <string.h>
+#include "evlog_test.h"
+
+static const uint32_t kMax = 16U;
+static uint32_t buf[1024];
+
+template <class P> using Log = EventLog<EvlogUser, P, EvlogTsCycles, 4>;
+
+static uint32_t lost(const evlog_drops_t& d) {
+  return d.dropped + d.overwritten;
+}
+
+static uint32_t fmt_count(const evlog_drops_t& d, const char *fmt) {
+  for (size_t i = 0; i < EVLOG_DROP_FMTS; i++)
+    if (fmt == d.fmt[i].fmt)
+      return d.fmt[i].count;
+  return 0U;
+}
+
+template <class P>
+static void check_resume(void) {
+  const char *fmt = PSTR("lost %u");
+  Log<P> lg;
+  CHECK(lg.place(buf, Log<P>::size_of(kMax)));
+  lg.preinit(EVLOG_NOZERO_COOKIE | 1U);
+  for (uint32_t i = 0; i < kMax + 10U; i++)
+    lg.log(fmt, i);
+
+  evlog_drops_t before;
+  lg.get_drops(&before);
+  // After the "Inited" entry kMax - 1 of ours fit.
+  CHECK_EQ(lost(before), 11U);
+  CHECK(0U != before.first_ts);
+
+  Log<P> again;
+  CHECK(again.place(buf, Log<P>::size_of(kMax)));
+  again.preinit(1U);
+  evlog_drops_t after;
+  again.get_drops(&after);
+  // Plus the Resumed entry, and with EVLOG_SALVAGE the Salvaged one.
+  CHECK(lost(after) > lost(before));
+  CHECK(lost(after) <= lost(before) + 2U);
+  CHECK_EQ(after.first_ts, before.first_ts);
+  if (P::circular)  // The oldest entries overwritten are ours
+    CHECK_EQ(fmt_count(after, fmt) - fmt_count(before, fmt), lost(after) - lost(before));
+  else
+    CHECK_EQ(fmt_count(after, fmt), 11U);
+
+  again.clear();
+  again.get_drops(&after);
+  CHECK_EQ(lost(after), 0U);
+}
+
+static void check_calibrate(void) {
+  evlog_preinit(1U);
+  for (uint32_t i = 0; i < evlog_get_max_events() + 5U; i++)
+    EVLOG2("fill %u", i);
+
+  evlog_drops_t before, after;
+  evlog_get_drops(&before);
+  CHECK(0U != lost(before));
+  CHECK(evlog_calibrate(16U));
+  evlog_get_drops(&after);
+  CHECK(0 == memcmp(&before, &after, sizeof(before)));
+}
+
+int main() {
+  check_resume<EvlogLinear>();
+  check_resume<EvlogCircular>();
+  check_calibrate();
+  return evlog_test_result();
+}
@@ -0,0 +1,75 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Heap counters with blocks allocated before tracing started. Bytes in use
+  must count them, and freeing them must not take in use below what is
+  still allocated, or wrap it. A calloc() size that overflows saturates.
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_heap.h>
+#include <stdlib.h>
+#include "evlog_test.h"
+
+static uint32_t in_use(void) {
+  evlog_heap_stats_t s;
+  evlog_heap_get_stats(&s);
+  return s.in_use;
+}
+
+int main() {
+  evlog_preinit(1U);
+  // volatile, so the compiler keeps the calls.
+  void * volatile early = malloc(4000);
+  CHECK(NULL != early);
+
+  evlog_heap_stats_clear();
+  evlog_heap_trace(EVLOG_HEAP_COUNTERS);
+  uint32_t start = in_use();
+  CHECK(start >= 4000U);
+
+  void * volatile late = malloc(100);
+  uint32_t both = in_use();
+  CHECK(both >= start + 100U);
+
+  free(early);
+  uint32_t after = in_use();
+  CHECK(after + 4000U <= both);
+  CHECK(after >= 100U);
+
+  late = realloc(late, 3000);
+  // Less the 100 byte block, when grown in place.
+  CHECK(in_use() >= after + 2800U);
+  free(late);
+  CHECK(in_use() < both);
+
+  evlog_heap_stats_t s;
+  evlog_heap_get_stats(&s);
+  CHECK_EQ(s.allocs, 1U);
+  CHECK_EQ(s.reallocs, 1U);
+  CHECK_EQ(s.frees, 2U);
+  CHECK(s.peak >= both);
+
+  // count * size past SIZE_MAX fails, counted in the open ended class.
+  volatile size_t count = SIZE_MAX / 2U;
+  CHECK(NULL == calloc(count, 4U));
+  evlog_heap_get_stats(&s);
+  CHECK_EQ(s.allocs, 2U);
+  CHECK_EQ(s.failed, 1U);
+  CHECK_EQ(s.hist[EVLOG_HEAP_CLASSES - 1U], 1U);
+  evlog_heap_trace(0U);
+  return evlog_test_result();
+}
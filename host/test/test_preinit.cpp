@@ -0,0 +1,54 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  evlog_preinit() before the C++ constructors, as from app_entry_redefinable()
+  on the device. The log and its EVLOG_NOZERO_COOKIE state must still be
+  there in main(), and a later evlog_preinit() must resume, not clear, it.
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include "evlog_test.h"
+
+static uint32_t early_count = 0;
+static uint32_t early_state = 0;
+
+__attribute__((constructor(101)))
+static void early(void) {
+  evlog_preinit(EVLOG_NOZERO_COOKIE | 1U);
+  EVLOG1("early event");
+  early_count = evlog_get_count();
+  early_state = evlog_get_state();
+}
+
+int main() {
+  CHECK_EQ(early_count, 2U);    // "Inited" and ours
+  CHECK_EQ(early_state, EVLOG_NOZERO_COOKIE | 1U);
+  CHECK(evlog_is_inited());
+  CHECK_EQ(evlog_get_count(), early_count);
+  CHECK_EQ(evlog_get_state(), early_state);
+
+  // As at the next boot.
+  evlog_preinit(1U);
+  CHECK_EQ(evlog_get_count(), early_count + 1U);
+  CHECK_EQ(evlog_get_state(), EVLOG_NOZERO_COOKIE | 1U);
+
+  void *base = NULL;
+  size_t size = 0;
+  evlog_get_storage(&base, &size);
+  CHECK(NULL != base);
+  CHECK(0U != size);
+  return evlog_test_result();
+}
@@ -0,0 +1,62 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Queries by fmt with the slot index, over a log restarted or cleared after
+  the index was built, then grown past where it was. The bits of the old
+  log must not be kept.
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_query.h>
+#include "evlog_test.h"
+
+static uint32_t count_of(const char *fmt) {
+  evlog_query_t q;
+  evlog_query_init(&q);
+  q.fmt = fmt;
+  return evlog_query(&q, NULL, NULL);
+}
+
+int main() {
+  const char *a = PSTR("A %u");
+  const char *b = PSTR("B %u");
+  evlog_preinit(1U);
+  CHECK(EVLOG_QUERY_INDEX_SLOTS >= evlog_get_max_events());
+
+  for (uint32_t i = 0; i < 10U; i++)
+    EVLOG2_P(b, i);
+  CHECK_EQ(count_of(a), 0U);
+  CHECK_EQ(count_of(b), 10U);
+
+  evlog_restart(1U);
+  for (uint32_t i = 0; i < 20U; i++)
+    EVLOG2_P(a, i);
+  CHECK_EQ(count_of(a), 20U);
+  CHECK_EQ(count_of(b), 0U);
+
+  evlog_clear();
+  evlog_set_state(1U);  // Cleared with the rest
+  for (uint32_t i = 0; i < 30U; i++)
+    EVLOG2_P(b, i);
+  CHECK_EQ(count_of(a), 0U);
+  CHECK_EQ(count_of(b), 30U);
+
+  // The same answers from a scan.
+  evlog_query_index_clear();
+  CHECK_EQ(count_of(a), 0U);
+  CHECK_EQ(count_of(b), 30U);
+  return evlog_test_result();
+}
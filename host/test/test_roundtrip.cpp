@@ -0,0 +1,107 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  evlogWriteCompressed(), with and without LZ, unpacked by host/evlog_unpack
+  must give back evlogWriteDump() byte for byte. The log overflows, so the
+  drops section is in it, and has more fmts than the pack dictionary holds.
+
+    test_roundtrip BUILD_DIR     evlog_unpack is looked for in BUILD_DIR
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_dump.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "evlog_test.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+// More than EVLOG_PACK_DICT, each its own address.
+static char fmts[EVLOG_PACK_DICT + 16U][16];
+
+static bool read_file(const std::string& path, Bytes& bytes) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (NULL == f)
+    return false;
+  uint8_t buf[4096];
+  size_t n;
+  while (0 < (n = fread(buf, 1, sizeof(buf), f)))
+    bytes.insert(bytes.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static bool write_dump(const std::string& path, int how) {
+  FILE *f = fopen(path.c_str(), "wb");
+  if (NULL == f)
+    return false;
+  HostFilePrint out(f);
+  bool ok = (0 == how) ? evlogWriteDump(out) : (0U != evlogWriteCompressed(out, 2 == how));
+  return (0 == fclose(f)) && ok;
+}
+
+static void fill_log(void) {
+  evlog_preinit(1U);
+  const size_t n_fmts = sizeof(fmts) / sizeof(fmts[0]);
+  for (size_t i = 0; i < n_fmts; i++)
+    snprintf(fmts[i], sizeof(fmts[i]), "fmt %u %%d", (unsigned)i);
+
+  // Past the end of the log, repeats for LZ, negative and large data.
+  uint32_t events = evlog_get_max_events() * 3U / 2U;
+  for (uint32_t i = 0; i < events; i++) {
+    const char *fmt = fmts[(i * 7U) % n_fmts];
+    if (0U == (i & 3U))
+      EVLOG5("repeat %d %d %d %d", 1, 2, 3, 4);
+    else
+      EVLOG5_P(fmt, i, -(int32_t)i, 0xFFFFFFFFU - i, i * i * 12345U);
+  }
+}
+
+int main(int argc, char **argv) {
+  std::string dir = (argc > 1) ? argv[1] : ".";
+  fill_log();
+  CHECK(0U != evlog_get_count());
+
+  std::string dump = dir + "/roundtrip.dump";
+  CHECK(write_dump(dump, 0));
+  Bytes want;
+  CHECK(read_file(dump, want));
+  CHECK(sizeof(evlog_dump_header_t) < want.size());
+
+  for (int how = 1; how <= 2; how++) {
+    std::string packed = dir + ((2 == how) ? "/roundtrip.lz" : "/roundtrip.pack");
+    std::string unpacked = packed + ".dump";
+    CHECK(write_dump(packed, how));
+    std::string cmd = dir + "/evlog_unpack " + packed + " " + unpacked;
+    CHECK_EQ(system(cmd.c_str()), 0);
+
+    Bytes packed_bytes, got;
+    CHECK(read_file(packed, packed_bytes));
+    CHECK(read_file(unpacked, got));
+    CHECK(packed_bytes.size() < want.size());
+    CHECK_EQ(got.size(), want.size());
+    if (got != want) {
+      size_t at = 0;
+      while (at < got.size() && at < want.size() && got[at] == want[at])
+        at++;
+      fprintf(stderr, "%s: differs at byte %zu\n", unpacked.c_str(), at);
+      CHECK(false);
+    }
+  }
+  return evlog_test_result();
+}
@@ -0,0 +1,67 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  The RTC log over two wakes, with a fmt that has no ID. It must be stored
+  as EVLOG_RTC_ID_NONE, not taken for a wake marker, and with
+  EVLOG_RTC_TS_DELTA must not start the time sums over.
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_rtc.h>
+#include <string.h>
+#include "evlog_test.h"
+
+int main() {
+  evlog_preinit(1U);
+  CHECK(!evlog_rtc_init());   // First boot, cleared
+
+  // Not a PSTR, outside the image.
+  static const char *not_pstr = strdup("not a PSTR %u");
+  CHECK_EQ(evlog_fmt_id(not_pstr), EVLOG_RTC_ID_NONE);
+  CHECK(NULL == evlog_id_fmt(EVLOG_RTC_ID_WAKE));
+
+  const char *fmt = PSTR("rtc %u");
+  uint16_t id = evlog_fmt_id(fmt);
+  CHECK(EVLOG_RTC_ID_NONE != id && EVLOG_RTC_ID_WAKE != id);
+  CHECK(fmt == evlog_id_fmt(id));
+
+  for (uint32_t i = 0; i < 4U; i++) {
+    EVLOG_RTC_P(fmt, i);
+    EVLOG_RTC_P(not_pstr, i);
+  }
+  CHECK(evlog_rtc_init());    // Next wake, kept
+
+  const uint16_t want_id[] = {
+    EVLOG_RTC_ID_WAKE, id, EVLOG_RTC_ID_NONE, id, EVLOG_RTC_ID_NONE,
+    id, EVLOG_RTC_ID_NONE, id, EVLOG_RTC_ID_NONE, EVLOG_RTC_ID_WAKE,
+  };
+  const uint16_t want_arg[] = { 1, 0, 0, 1, 1, 2, 2, 3, 3, 2 };
+  const uint32_t n = sizeof(want_id) / sizeof(want_id[0]);
+  CHECK_EQ(evlog_rtc_get_count(), n);
+
+  evlog_rtc_entry_t e;
+  uint32_t i = 0, last_ts = 0;
+  for (bool more = evlog_rtc_get_event(&e, true); more && i < n; more = evlog_rtc_get_event(&e, false), i++) {
+    CHECK_EQ(e.id, want_id[i]);
+    CHECK_EQ(e.arg, want_arg[i]);
+    // Times only go up between wakes, as sums of deltas too.
+    if (0U < i && EVLOG_RTC_ID_WAKE != e.id)
+      CHECK(last_ts <= e.ts);
+    last_ts = e.ts;
+  }
+  CHECK_EQ(i, n);
+  return evlog_test_result();
+}
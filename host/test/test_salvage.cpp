@@ -0,0 +1,254 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  EVLOG_SALVAGE on a resumed log, linear and circular, with a torn last
+  entry, bit flips in the data and in the check word, and a corrupt num or
+  wrapped. Each case is resumed by a new EventLog over the same memory, as
+  after a reset. Checked are the num, wrapped and torn count reported by
+  ">>> EvLog Salvaged <<<", that each corrupted slot is marked torn, and
+  that every other entry is kept as it was.
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_instance.h>
+#include <string.h>
+#include "evlog_test.h"
+
+#ifndef EVLOG_SALVAGE
+#error "Build with EVLOG_SALVAGE, see host/test.sh"
+#endif
+
+static const uint32_t kMax = 16U;
+static uint32_t buf[1024];
+
+template <class P> using Log = EventLog<EvlogUser, P, EvlogTsCycles, 4>;
+
+static const char *ev_fmt(void) {
+  return PSTR("ev %u %u %u");
+}
+
+template <class P>
+static void start(Log<P>& lg, uint32_t events) {
+  CHECK(lg.place(buf, Log<P>::size_of(kMax)));
+  CHECK_EQ(lg.get_max_events(), kMax);
+  lg.init();
+  lg.clear();
+  lg.set_state(EVLOG_NOZERO_COOKIE | 1U);
+  for (uint32_t i = 0; i < events; i++)
+    lg.log(ev_fmt(), i, i * 3U, ~i);
+}
+
+// A reset in the middle of storing an event at `slot`, before its check word.
+template <class P>
+static void tear(Log<P>& lg, uint32_t slot) {
+  lg.header()->seq++;
+  lg.events()[slot].fmt = ev_fmt();
+  lg.events()[slot].data[0] = 77U;
+}
+
+struct Salvaged {
+  uint32_t num;
+  uint32_t wrapped;
+  uint32_t torn;
+};
+
+/*
+  Resumes the log and checks it against the one before. `corrupt` has a bit
+  per slot damaged by the case. Returns what the Salvaged entry reports.
+*/
+template <class P>
+static Salvaged resume(Log<P>& lg, uint32_t corrupt, int line) {
+  typedef typename Log<P>::entry_type entry_type;
+  entry_type before[kMax];
+  memcpy(before, lg.events(), sizeof(before));
+
+  Log<P> again;
+  void *base = NULL;
+  size_t bytes = 0;
+  lg.get_storage(&base, &bytes);
+  again.place(base, bytes);
+  again.preinit(EVLOG_NOZERO_COOKIE | 1U);
+
+  // Resumed then Salvaged, right after the rebuilt end.
+  Salvaged s = {~0U, ~0U, ~0U};
+  bool wrapped = false;
+  uint32_t num = again.get_num(&wrapped);
+  uint32_t last = (num + kMax - 1U) % kMax;
+  entry_type e;
+  CHECK(again.get_event_at(last, &e));
+  if (e.fmt && 0 == strcmp(e.fmt, ">>> EvLog Salvaged <<< num(%u), wrapped(%u), torn(%u)")) {
+    s.num = e.data[0];
+    s.wrapped = e.data[1];
+    s.torn = e.data[2];
+  }
+  uint32_t written = (1U << last) | (1U << ((last + kMax - 1U) % kMax));
+
+  uint32_t marked = 0U;
+  for (uint32_t slot = 0; slot < kMax; slot++) {
+    if (written & (1U << slot))
+      continue;
+    CHECK(again.get_event_at(slot, &e));
+    if (corrupt & (1U << slot)) {
+      if (e.fmt != evlog_torn_fmt())
+        fprintf(stderr, "line %d: slot %u not marked torn\n", line, slot);
+      CHECK(e.fmt == evlog_torn_fmt());
+      marked++;
+    } else if (0 != memcmp(&e, &before[slot], sizeof(e))) {
+      fprintf(stderr, "line %d: slot %u changed\n", line, slot);
+      CHECK(false);
+    }
+  }
+  // The torn count covers the corrupted slots, marked or since rewritten.
+  CHECK_EQ(s.torn, (uint32_t)__builtin_popcount(corrupt));
+  CHECK(marked <= s.torn);
+  return s;
+}
+
+#define CHECK_SALVAGED(s, n, w, t) do{ \
+    CHECK_EQ((s).num, (n)); \
+    CHECK_EQ((s).wrapped, (w)); \
+    CHECK_EQ((s).torn, (t)); \
+  }while(false)
+
+static void test_linear(void) {
+  typedef Log<EvlogLinear> L;
+  L lg;
+  Salvaged s;
+
+  start(lg, 10U);
+  s = resume(lg, 0U, __LINE__);
+  CHECK_SALVAGED(s, 10U, 0U, 0U);
+  CHECK_EQ(lg.get_num(NULL), 12U);
+
+  // Torn last entry, num was not yet bumped.
+  start(lg, 10U);
+  tear(lg, 10U);
+  s = resume(lg, 1U << 10, __LINE__);
+  CHECK_SALVAGED(s, 10U, 0U, 1U);
+
+  // Bit flips in the data, the timestamp and the check word.
+  start(lg, 10U);
+  lg.events()[3].data[1] ^= 0x100U;
+  lg.events()[4].ts ^= 1U;
+  lg.events()[5].check ^= 1U;
+  lg.events()[6].check ^= 1U << 16;
+  s = resume(lg, 0xFU << 3, __LINE__);
+  CHECK_SALVAGED(s, 10U, 0U, 4U);
+
+  // A flip in the newest entry, the one before it becomes the end.
+  start(lg, 10U);
+  lg.events()[9].data[2] ^= 0x80000000U;
+  s = resume(lg, 1U << 9, __LINE__);
+  CHECK_SALVAGED(s, 9U, 0U, 1U);
+
+  // Corrupt num and wrapped.
+  start(lg, 10U);
+  lg.header()->num = 3U;
+  lg.header()->wrapped = 1U;
+  s = resume(lg, 0U, __LINE__);
+  CHECK_SALVAGED(s, 10U, 0U, 0U);
+
+  start(lg, 10U);
+  lg.header()->num = 0x7FFFFFFFU;
+  s = resume(lg, 0U, __LINE__);
+  CHECK_SALVAGED(s, 10U, 0U, 0U);
+
+  // Full, the Resumed and Salvaged entries are dropped.
+  start(lg, kMax + 3U);
+  lg.header()->num = 1U;
+  L again;
+  again.place(buf, L::size_of(kMax));
+  again.preinit(EVLOG_NOZERO_COOKIE | 1U);
+  bool wrapped = false;
+  CHECK_EQ(again.get_num(&wrapped), kMax);
+  CHECK(wrapped);
+
+  // Empty.
+  start(lg, 0U);
+  lg.header()->num = 9U;
+  s = resume(lg, 0U, __LINE__);
+  CHECK_SALVAGED(s, 0U, 0U, 0U);
+}
+
+static void test_circular(void) {
+  typedef Log<EvlogCircular> L;
+  L lg;
+  Salvaged s;
+
+  // 40 in 16 slots, the next is slot 8.
+  start(lg, 40U);
+  s = resume(lg, 0U, __LINE__);
+  CHECK_SALVAGED(s, 8U, 1U, 0U);
+  CHECK_EQ(lg.get_num(NULL), 10U);
+
+  // Torn last entry, over the oldest.
+  start(lg, 40U);
+  tear(lg, 8U);
+  s = resume(lg, 1U << 8, __LINE__);
+  CHECK_SALVAGED(s, 8U, 1U, 1U);
+
+  // Bit flips, one in the check word's sequence number.
+  start(lg, 40U);
+  lg.events()[12].data[0] ^= 4U;
+  lg.events()[2].check ^= 1U << 20;
+  lg.events()[3].check ^= 0x8000U;
+  s = resume(lg, (1U << 12) | (1U << 2) | (1U << 3), __LINE__);
+  CHECK_SALVAGED(s, 8U, 1U, 3U);
+
+  // Corrupt num and wrapped.
+  start(lg, 40U);
+  lg.header()->num = 0U;
+  lg.header()->wrapped = 0U;
+  s = resume(lg, 0U, __LINE__);
+  CHECK_SALVAGED(s, 8U, 1U, 0U);
+
+  // Newest at the last slot, the end is slot 0.
+  start(lg, 32U);
+  lg.header()->num = 5U;
+  s = resume(lg, 0U, __LINE__);
+  CHECK_SALVAGED(s, kMax, 1U, 0U);
+
+  // Not wrapped, though the header says so.
+  start(lg, 5U);
+  lg.header()->num = 15U;
+  lg.header()->wrapped = 1U;
+  s = resume(lg, 0U, __LINE__);
+  CHECK_SALVAGED(s, 5U, 0U, 0U);
+}
+
+// The default log, resumed by evlog_preinit().
+static void test_default(void) {
+  evlog_preinit(EVLOG_NOZERO_COOKIE | 1U);
+  for (uint32_t i = 0; i < 3U; i++)
+    EVLOG2("default %u", i);
+  evlog_preinit(1U);
+
+  uint32_t count = evlog_get_count();
+  CHECK_EQ(count, 6U);
+  evlog_entry_t e;
+  CHECK(evlog_get_event_at(count - 1U, &e));
+  CHECK(e.fmt && 0 == strcmp(e.fmt, ">>> EvLog Salvaged <<< num(%u), wrapped(%u), torn(%u)"));
+  CHECK_EQ(e.data[0], 4U);
+  CHECK_EQ(e.data[1], 0U);
+  CHECK_EQ(e.data[2], 0U);
+}
+
+int main() {
+  test_linear();
+  test_circular();
+  test_default();
+  return evlog_test_result();
+}
@@ -0,0 +1,68 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Span durations once calibrated leave out evlog_get_overhead() per span
+  event logged inside the span, here 1 + 2 * kChildren. Put back, the
+  duration must lie between the timestamps of the events around the span's
+  start and end. Its end event carries the value evlog_span_end() returns.
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_span.h>
+#include "evlog_test.h"
+
+static const uint32_t kChildren = 40U;
+
+static uint32_t ts_at(uint32_t slot) {
+  evlog_entry_t e;
+  CHECK(evlog_get_event_at(slot, &e));
+  return e.ts;
+}
+
+static void check_span(uint32_t overhead) {
+  evlog_restart(1U);
+  EVLOG1("before the span");
+  uint32_t before = evlog_get_count() - 1U;
+
+  uint32_t outer = EVLOG_BEGIN("outer %u", 0U);
+  for (uint32_t i = 0; i < kChildren; i++)
+    EVLOG_END(EVLOG_BEGIN("child %u", i));
+  uint32_t ticks = evlog_span_end(outer);
+
+  uint32_t end = evlog_get_count() - 1U;
+  CHECK_EQ(end, before + 2U + 2U * kChildren);
+  evlog_entry_t e;
+  CHECK(evlog_get_event_at(end, &e));
+  CHECK_EQ(e.data[3], ticks);
+
+  // The start was taken after the event before it and ahead of its begin
+  // event, the end after the last child's end event and ahead of its own.
+  uint64_t raw = (uint64_t)ticks + (1U + 2U * kChildren) * (uint64_t)overhead;
+  CHECK(ts_at(end - 1U) - ts_at(before + 1U) < raw);
+  CHECK(raw < ts_at(end) - ts_at(before));
+}
+
+int main() {
+  evlog_preinit(1U);
+  CHECK_EQ(evlog_get_overhead(), 0U);
+  check_span(0U);
+
+  CHECK(evlog_calibrate(64U));
+  uint32_t overhead = evlog_get_overhead();
+  CHECK(0U != overhead);
+  check_span(overhead);
+  return evlog_test_result();
+}
@@ -0,0 +1,64 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  evlogWriteChromeTrace() to a Print that fills up. It must return false
+  once a write is cut short, true when all of it was taken, and leave
+  logging as it was either way.
+*/
+#include <evlog/src/evlog_host.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_trace.h>
+#include "evlog_test.h"
+
+// Takes `room` bytes, then no more.
+class FullPrint : public Print {
+public:
+  FullPrint(size_t room) : room(room) {}
+  using Print::write;
+  size_t write(uint8_t c) override {
+    return write(&c, 1U);
+  }
+  size_t write(const uint8_t *buf, size_t size) override {
+    (void)buf;
+    size_t n = (size < room) ? size : room;
+    room -= n;
+    taken += n;
+    return n;
+  }
+
+  size_t room;
+  size_t taken = 0;
+};
+
+int main() {
+  evlog_preinit(1U);
+  for (uint32_t i = 0; i < 20U; i++)
+    EVLOG2("trace %u", i);
+
+  FullPrint all((size_t)-1);
+  CHECK(evlogWriteChromeTrace(all));
+  CHECK(0U != all.taken);
+
+  // Short at the start, in the events, and on the last byte.
+  size_t cut[] = { 10U, all.taken / 2U, all.taken - 1U };
+  for (size_t room : cut) {
+    FullPrint part(room);
+    CHECK(!evlogWriteChromeTrace(part));
+    CHECK_EQ(part.taken, room);
+    CHECK(evlog_is_enable());
+  }
+  return evlog_test_result();
+}
@@ -26,24 +26,36 @@
     is no longer managed by anyone but EvLog. Nobody zero's it. I have been
     successful in carrying data forward between boot cycles.
 
-    STATUS: It has been a while since I last used the RTC build option. So the
-    RTC build will not work. There is logic to support circular logging or
+    STATUS: The RTC build option is back as EVLOG_STORAGE_RTC, RTC memory is
+    only written 32 bits at a time. For events that must survive deep sleep,
+    see the compact RTC log in evlog_rtc.cpp. There is logic to support circular logging or
     linear logging. EVLOG_CIRCULAR has not been tested a lot. The linear
     logging option has been working well. Linear logging is the default when
     #define EVLOG_CIRCULAR is omitted.
 
 */
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
 #include <Arduino.h>
+#endif
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/time.h>
+#ifndef EVLOG_HOST
 #include "c_types.h"
 #include "ets_sys.h"
 #include "user_interface.h"
 
 #include <umm_malloc/umm_malloc_cfg.h>
+#endif
 #include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_print.h>
+#include <evlog/src/evlog_instance.h>
+#include <evlog/src/evlog_sample.h>
 
 #ifdef EVENT_LOGGER_H //EVLOG_ENABLE
 
@@ -51,88 +63,123 @@ extern "C" {
 // Need when used from ISR etc context. Comment out otherwise.
 #define IRAM_OPTION ICACHE_RAM_ATTR
 
-// Start event log after OTA Data - this leaves 96 words
-#ifdef EVLOG_WITH_DRAM
-#define EVLOG_ADDR_QUALIFIER
-#define EVLOG_ADDR ((EVLOG_ADDR_QUALIFIER uint32_t *)umm_static_reserve_addr)
-#define EVLOG_ADDR_SZ (umm_static_reserve_size/sizeof(uint32_t) - 5U)
+// Solution inspired by https://stackoverflow.com/a/1254012
+#define _STR_CAT(w, x) w ## x
+#define MK_NAME(y, z) _STR_CAT(y, z)
 
+#ifdef EVLOG_WITH_DRAM
+#define EVLOG_DEFAULT_STORAGE EVLOG_STORAGE_DRAM
 #else
-#define EVLOG_RTC_MEMORY 1
-#define EVLOG_ADDR_QUALIFIER volatile
-#define EVLOG_ADDR ((EVLOG_ADDR_QUALIFIER uint32_t*)0x60001280U)
-#define EVLOG_ADDR_SZ ((uint32_t)128 - 32U - 5U)  // USER_RTC - EBOOT - sizeof(num and state) - sizeof(bool?)
+#define EVLOG_DEFAULT_STORAGE EVLOG_STORAGE_RTC
 #endif
 
+static_assert(sizeof(EvlogDefault::entry_type) == sizeof(evlog_entry_t), "EvlogDefault holds evlog_entry_t");
 
-#ifndef MAX_EVENTS
-#define MAX_EVENTS (EVLOG_ADDR_SZ/(sizeof(evlog_entry_t)/sizeof(uint32_t))) //(47)
-#endif
-
-typedef struct _EVLOG_STRUCT evlog_t;
-
-struct _EVLOG_STRUCT {
-    uintptr_t cookie; // Must be 1st and
-    uint32_t num;     // must be 2nd. If changed, clear_log must be updated!
-    uint32_t state;
-    evlog_entry_t event[MAX_EVENTS];
-    bool wrapped;
-};
+/*
+  The log behind the C API, set by evlog_set_storage(). Until then the first
+  evlog_init() or evlog_preinit() places it in the default storage, and
+  makes the cookie for it there.
+*/
+static EVLOG_CONSTINIT EvlogDefault evlog_default(EVLOG_DEFAULT_STORAGE);
 
-#ifdef EVLOG_WITH_DRAM
-static_assert((sizeof(evlog_t) <= umm_static_reserve_size), "MAX_EVENTS too large exceeds static reserve size.");
-#else
-static_assert((sizeof(evlog_t) + ((uint32_t)EVLOG_ADDR - 0x60001200U) <= 512U), "MAX_EVENTS too large. Total RTC Memory usage exceeds 512.");
-#endif
+/*
+  Where an EventLog points until it is placed. Never written. In .data, not
+  .bss, so it reads as not inited before the SDK clears .bss.
+*/
+evlog_header_t evlog_unplaced __attribute__((section(".data"))) = evlog_header_t();
 
-// Solution inspired by https://stackoverflow.com/a/1254012
-#define _STR_CAT(w, x) w ## x
-#define MK_NAME(y, z) _STR_CAT(y, z)
+/*
+  The fmt an EVLOG_SALVAGE pass gives an entry torn by a reset, one address
+  for all logs.
+*/
+const char *evlog_torn_fmt(void) {
+    return PSTR("<<< EvLog torn entry >>>");
+}
 
-constexpr uint32_t EVLOG_ADDR_QUALIFIER *pu32_evlog_addr = EVLOG_ADDR;
-constexpr evlog_t EVLOG_ADDR_QUALIFIER * p_evlog = (evlog_t EVLOG_ADDR_QUALIFIER *)EVLOG_ADDR;
-constexpr uintptr_t k_cookie = (((uintptr_t)p_evlog) << 1 | 1);
+/*
+  The fixed area of EVLOG_STORAGE_DRAM or EVLOG_STORAGE_RTC, as
+  evlog_storage_area(). In IRAM, it places the default log at its first
+  EVLOG*(), which may be from an ISR or with the flash cache off.
+*/
+uintptr_t IRAM_OPTION evlog_static_area(evlog_storage_t storage, void *base, size_t *size) {
+    uintptr_t addr = (uintptr_t)base;
+    uintptr_t start;
+    size_t area;
+    // No switch, its jump table could be in flash.
+    if (EVLOG_STORAGE_DRAM == storage) {
+        start = (uintptr_t)umm_static_reserve_addr;
+        area = umm_static_reserve_size;
+    } else if (EVLOG_STORAGE_RTC == storage) {
+        start = (uintptr_t)EVLOG_RTC_ADDR;
+        area = EVLOG_RTC_SZ;
+    } else {
+        return 0U;
+    }
+    if (0 == addr)
+        addr = start;
+    else if (addr < start || addr >= start + area)
+        return 0U;
+    area -= addr - start;
+    if (0 == *size || *size > area)
+        *size = area;
+
+    return addr;
+}
 
-inline __attribute__((__always_inline__))
-void IRAM_OPTION clear_log(void) {
-#if 1
-    // cookie must be 1st element in structure and num 2nd.
-    ets_memset(&p_evlog->num, 0, sizeof(evlog_t) - sizeof(p_evlog->cookie));
-#else
-    uintptr_t cookie = p_evlog->cookie;
-    for (size_t i=0; i<(sizeof(evlog_t)/sizeof(int32_t)); i++)
-        pu32_evlog_addr[i]=0;
+/*
+  The usable area for a log at `base`, `*size` bytes, trimmed to what the
+  storage holds. `base` and `*size` may be 0 for EVLOG_STORAGE_DRAM and
+  EVLOG_STORAGE_RTC, to use the whole area. EVLOG_STORAGE_HEAP allocates
+  `*size` bytes. Returns the address, 0 when rejected.
+*/
+uintptr_t evlog_storage_area(evlog_storage_t storage, void *base, size_t *size) {
+    uintptr_t addr = (uintptr_t)base;
+    switch (storage) {
+        case EVLOG_STORAGE_DRAM:
+        case EVLOG_STORAGE_RTC:
+            return evlog_static_area(storage, base, size);
+        case EVLOG_STORAGE_HEAP:
+            if (0 == *size)
+                return 0U;
+            addr = (uintptr_t)malloc(*size);
+            break;
+        case EVLOG_STORAGE_USER:
+            break;
+        default:
+            return 0U;
+    }
+    return addr;
+}
 
-    p_evlog->cookie = cookie;
-#endif
+/*
+  Select where the log lives. Nothing is written to the new location, the next
+  evlog_init() validates the cookie there, and clears it when it does not
+  match. `base` and `size` may be 0 for EVLOG_STORAGE_DRAM and
+  EVLOG_STORAGE_RTC, to use the whole area. EVLOG_STORAGE_HEAP allocates
+  `size` bytes, the block is freed when storage is changed again.
+*/
+bool evlog_set_storage(evlog_storage_t storage, void *base, size_t size) {
+    return evlog_default.set_storage(storage, base, size);
 }
 
-void IRAM_OPTION evlog_clear(void) {
-    clear_log();
+evlog_storage_t evlog_get_storage(void **base, size_t *size) {
+    return evlog_default.get_storage(base, size);
 }
 
-inline __attribute__((__always_inline__))
-bool IRAM_OPTION is_inited(void) {
-    return (k_cookie == p_evlog->cookie);
+void IRAM_OPTION evlog_clear(void) {
+    evlog_default.clear();
 }
 
 bool IRAM_OPTION evlog_is_inited(void) {
-    return is_inited();
+    return evlog_default.is_inited();
 }
 
-/*
-*/
 uint32_t IRAM_OPTION evlog_get_state(void) {
-    if (is_inited())
-        return p_evlog->state;
-
-    return 0;
+    return evlog_default.get_state();
 }
 
 uint32_t IRAM_OPTION evlog_set_state(uint32_t state) {
-    uint32_t previous = evlog_get_state();
-    p_evlog->state = state;
-    return previous;
+    return evlog_default.set_state(state);
 }
 
 
@@ -140,24 +187,15 @@ uint32_t IRAM_OPTION evlog_set_state(uint32_t state) {
   Our block of memory lives outside the normal "C" runtime initialization stuff.
   We need to detect when its bad and zero it.
 
-  `p_evlog->cookie` is our flag that memory has been initialized by us. If
-  it is invalid, either we were just powered on, in deep power save (PD pin was
+  The cookie is our flag that memory has been initialized by us. If it is
+  invalid, either we were just powered on, in deep power save (PD pin was
   held low), or we just came out of deep sleep. Either way we need to initialize
   the log buffer.
 
   TODO: tracking and logging previous value of p_evlog is unecessary once pass early development phase.
 */
 uint32_t IRAM_OPTION evlog_init(void) {
-    uint32_t dirty_value = (uint32_t)p_evlog;
-    if (!is_inited()) {
-        clear_log();
-        // A unique value to indicate log buffer was initialized
-        p_evlog->cookie = k_cookie;
-        // Make things just work. For now always enable an inited log.
-        // evlog_preinit() can change it from there.
-        evlog_set_state(1U);
-    }
-    return dirty_value;
+    return evlog_default.init();
 }
 
 /*
@@ -169,19 +207,27 @@ uint32_t IRAM_OPTION evlog_init(void) {
   will continue operation with pre-existing state.
 */
 void IRAM_OPTION evlog_preinit(uint32_t new_state) {
-    uint32_t dirty_value = evlog_init();
-    // If we are called early at boot time. When cookie is set don't zero memory
-    if ((p_evlog->state & EVLOG_COOKIE_MASK) == EVLOG_NOZERO_COOKIE) {
-        if (MAX_EVENTS < p_evlog->num)
-            p_evlog->num = MAX_EVENTS; // Make it a valid value number, log full.
-            // Should never occur; however, this will allow for recovery of
-            // log in some broken situations.
-        EVLOG4(">>> EvLog Resumed <<< state(0x%08X), cookie(0x%08X), p_evlog(0x%08X))", p_evlog->state, p_evlog->cookie, dirty_value);
-        return;
-    }
-    clear_log();
-    evlog_set_state(new_state);
-    EVLOG4(">>> EvLog Inited <<< state(0x%08X), cookie(0x%08X), p_evlog(0x%08X)", p_evlog->state, p_evlog->cookie, dirty_value);
+    evlog_default.preinit(new_state);
+}
+
+/*
+  As evlog_init() and evlog_preinit(), with the log placed by
+  evlog_set_storage() first. When the placement is rejected, the log stays
+  where it was.
+
+  e.g. a large log for a debug session, from setup():
+      `evlog_preinit_at(1, EVLOG_STORAGE_HEAP, NULL, 16 * 1024);`
+  or a small persistent one, from preinit():
+      `evlog_preinit_at(EVLOG_NOZERO_COOKIE | 1, EVLOG_STORAGE_DRAM, NULL, 1024);`
+*/
+uint32_t evlog_init_at(evlog_storage_t storage, void *base, size_t size) {
+    evlog_set_storage(storage, base, size);
+    return evlog_init();
+}
+
+void evlog_preinit_at(uint32_t new_state, evlog_storage_t storage, void *base, size_t size) {
+    evlog_set_storage(storage, base, size);
+    evlog_preinit(new_state);
 }
 
 /*
@@ -193,27 +239,15 @@ void IRAM_OPTION evlog_preinit(uint32_t new_state) {
 */
 
 void IRAM_OPTION evlog_restart(uint32_t state) {
-    uint32_t dirty_value = evlog_init();
-    clear_log();
-    evlog_set_state(state);
-    EVLOG4(">>> EvLog Restarted <<< state(0x%08X), cookie(0x%08X), p_evlog(0x%08X)", state, p_evlog->cookie, dirty_value);
-    return;
+    evlog_default.restart(state);
 }
 
 bool IRAM_OPTION evlog_is_enable(void) {
-    if (is_inited()) {
-        uint32_t state = evlog_get_state();
-        state &= EVLOG_ENABLE_MASK;
-        return (0 == state) ? false : true;
-    }
-
-    return false;
+    return evlog_default.is_enable();
 }
 
-
-#ifdef EVLOG_CIRCULAR
-
-// uint32_t IRAM_OPTION evlog_event5(const char *fmt, uint32_t data0
+// Should look something like this when done
+//uint32_t IRAM_OPTION evlog_event5(const char *fmt, uint32_t data0, uint32_t data1, uint32_t data2, uint32_t data3)
 uint32_t IRAM_OPTION MK_NAME(evlog_event, EVLOG_TOTAL_ARGS)(const char *fmt
 #if (EVLOG_TOTAL_ARGS > 1)
       , uint32_t data0
@@ -229,159 +263,305 @@ uint32_t IRAM_OPTION MK_NAME(evlog_event, EVLOG_TOTAL_ARGS)(const char *fmt
 #endif
 
 ) {
-  evlog_init();
-
-  if (evlog_is_enable()) {
-      uint32_t num = p_evlog->num;
-      if (num >= MAX_EVENTS) {
-          num = 0;
-          p_evlog->wrapped = true;
-      }
-
-      p_evlog->event[num].fmt = fmt;
+    return evlog_default.log(fmt
 #if (EVLOG_TOTAL_ARGS > 1)
-      p_evlog->event[num].data[0] = data0;
+      , data0
 #endif
 #if (EVLOG_TOTAL_ARGS > 2)
-      p_evlog->event[num].data[1] = data1;
+      , data1
 #endif
 #if (EVLOG_TOTAL_ARGS > 3)
-      p_evlog->event[num].data[2] = data2;
+      , data2
 #endif
 #if (EVLOG_TOTAL_ARGS > 4)
-      p_evlog->event[num].data[3] = data3;
-#endif
-#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
-      p_evlog->event[num].ts = esp_get_cycle_count();
-#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
-      p_evlog->event[num].ts = micros();
-#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
-      p_evlog->event[num].ts = millis();
+      , data3
 #endif
-      p_evlog->num = ++num;
+    );
+}
 
-      return num;
-    }
+uint32_t evlog_get_count(void) {
+    return evlog_default.get_count();
+}
 
-    return 0;
+void evlog_get_drops(evlog_drops_t *drops) {
+    EVLOG_INTR_LOCK();
+    evlog_default.get_drops(drops);
+    EVLOG_INTR_UNLOCK();
 }
 
+uint32_t evlog_get_max_events(void) {
+    return evlog_default.get_max_events();
+}
 
-#else // Linear log and stop
-// Should look something like this when done
-//uint32_t IRAM_OPTION evlog_event5(const char *fmt, uint32_t data0, uint32_t data1, uint32_t data2, uint32_t data3)
+uint32_t evlog_get_num(bool *wrapped) {
+    return evlog_default.get_num(wrapped);
+}
 
-uint32_t IRAM_OPTION MK_NAME(evlog_event, EVLOG_TOTAL_ARGS)(const char *fmt
-// uint32_t IRAM_OPTION evlog_event5(const char *fmt, uint32_t data0
-#if (EVLOG_TOTAL_ARGS > 1)
-      , uint32_t data0
-#endif
-#if (EVLOG_TOTAL_ARGS > 2)
-      , uint32_t data1
-#endif
-#if (EVLOG_TOTAL_ARGS > 3)
-      , uint32_t data2
-#endif
-#if (EVLOG_TOTAL_ARGS > 4)
-      , uint32_t data3
-#endif
+uint32_t evlog_get_generation(void) {
+    return evlog_default.get_generation();
+}
 
-) {
-    evlog_init();
+bool evlog_get_event_at(uint32_t slot, evlog_entry_t *entry) {
+    return evlog_default.get_event_at(slot, entry);
+}
 
-    if (evlog_is_enable()) {
-        uint32_t num = p_evlog->num;
-        if (num < MAX_EVENTS) {
-            p_evlog->event[num].fmt = fmt;
-#if (EVLOG_TOTAL_ARGS > 1)
-            p_evlog->event[num].data[0] = data0;
-#endif
-#if (EVLOG_TOTAL_ARGS > 2)
-            p_evlog->event[num].data[1] = data1;
-#endif
-#if (EVLOG_TOTAL_ARGS > 3)
-            p_evlog->event[num].data[2] = data2;
-#endif
-#if (EVLOG_TOTAL_ARGS > 4)
-            p_evlog->event[num].data[3] = data3;
-#endif
-#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
-            p_evlog->event[num].ts = esp_get_cycle_count();
-#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
-            p_evlog->event[num].ts = micros();
-#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
-            p_evlog->event[num].ts = millis();
-#endif
-            p_evlog->num = ++num;
-            return num;
-        } else {
-            p_evlog->state &= ~EVLOG_ENABLE_MASK;
-            p_evlog->wrapped = true;
-        }
-    }
+uint32_t evlog_get_start_index(void) {
+    return evlog_default.get_start_index();
+}
 
-    return 0;
+bool evlog_get_event(evlog_entry_t *entry, bool first) {
+    return evlog_default.get_event(entry, first);
 }
-#endif
 
-uint32_t evlog_get_count(void) {
-    if (is_inited()) {
-        if (p_evlog->wrapped)
-            return MAX_EVENTS;
+/*
+  Self-benchmark - time each logging call with esp_get_cycle_count().
+
+  Every sample writes to the same slot, the one the next real event would
+  use, or the last slot when a linear log is full. The slot, `num`, `wrapped`,
+  `state` and the drop counts are restored after each sample.
 
-        return p_evlog->num;
+  The median EVLOG5 cost is kept as the calibrated overhead of a log call,
+  see evlog_get_overhead(). Span durations subtract it per span event, and
+  host/evlog_profile -o per profiler event.
+*/
+static evlog_calibration_t evlog_calibration;
+
+enum {
+    EVLOG_CAL_STAMP = 0,
+    EVLOG_CAL_EVLOG1,
+    EVLOG_CAL_EVLOG2,
+    EVLOG_CAL_EVLOG3,
+    EVLOG_CAL_EVLOG4,
+    EVLOG_CAL_EVLOG5,
+    EVLOG_CAL_DISABLED
+};
+
+static uint32_t IRAM_OPTION time_one_call(uint32_t which) {
+    uint32_t start, stop;
+    const char *fmt = PSTR("calibrate %u %u %u %u");
+    // Keep the switch out of the timed code.
+    switch (which) {
+        case EVLOG_CAL_EVLOG1:
+            start = esp_get_cycle_count(); EVLOG1_P(fmt); stop = esp_get_cycle_count();
+            break;
+        case EVLOG_CAL_EVLOG2:
+            start = esp_get_cycle_count(); EVLOG2_P(fmt, start); stop = esp_get_cycle_count();
+            break;
+        case EVLOG_CAL_EVLOG3:
+            start = esp_get_cycle_count(); EVLOG3_P(fmt, start, 1U); stop = esp_get_cycle_count();
+            break;
+        case EVLOG_CAL_EVLOG4:
+            start = esp_get_cycle_count(); EVLOG4_P(fmt, start, 1U, 2U); stop = esp_get_cycle_count();
+            break;
+        case EVLOG_CAL_EVLOG5:
+        case EVLOG_CAL_DISABLED:
+            start = esp_get_cycle_count(); EVLOG5_P(fmt, start, 1U, 2U, 3U); stop = esp_get_cycle_count();
+            break;
+        default:
+            start = esp_get_cycle_count(); stop = esp_get_cycle_count();
+            break;
     }
+    return stop - start;
+}
 
-    return 0U;
+static void calibrate_call(uint32_t which, uint32_t samples, uint32_t stamp, evlog_cycles_t *result) {
+    uint32_t cycles[EVLOG_CALIBRATE_MAX];
+    evlog_header_t *p_evlog = evlog_default.header();
+    evlog_entry_t *event = evlog_default.events();
+    uint32_t max_events = evlog_default.get_max_events();
+    uint32_t num = p_evlog->num;
+    uint32_t state = p_evlog->state;
+    bool wrapped = p_evlog->wrapped;
+#ifdef EVLOG_SALVAGE
+    uint32_t seq = p_evlog->seq;
+#endif
+    uint32_t slot = (max_events > num) ? num : max_events - 1U;
+    evlog_entry_t saved = event[slot];
+    evlog_drops_t drops;
+    evlog_default.get_drops(&drops);
+
+    for (size_t i = 0; i < samples; i++) {
+        p_evlog->num = slot;
+        if (EVLOG_CAL_DISABLED == which)
+            p_evlog->state = state & ~EVLOG_ENABLE_MASK;
+        else
+            p_evlog->state = state | 1U;
+
+        uint32_t c = time_one_call(which);
+        c = (c > stamp) ? c - stamp : 0U;
+
+        event[slot] = saved;
+        evlog_default.set_drops(drops);
+        p_evlog->num = num;
+        p_evlog->wrapped = wrapped;
+        p_evlog->state = state;
+#ifdef EVLOG_SALVAGE
+        p_evlog->seq = seq;
+#endif
+
+        // insertion sort, samples is small
+        size_t j = i;
+        for (; j > 0 && cycles[j - 1] > c; j--)
+            cycles[j] = cycles[j - 1];
+        cycles[j] = c;
+    }
+    result->min = cycles[0];
+    result->median = cycles[samples / 2U];
+    result->max = cycles[samples - 1U];
 }
 
-uint32_t evlog_get_start_index(void) {
-#ifdef EVLOG_CIRCULAR
-    if (is_inited() && p_evlog->wrapped)
-            return p_evlog->num;
-#endif
+bool evlog_calibrate(uint32_t samples) {
+    evlog_init();
+    if (0 == samples)
+        return false;
+
+    if (EVLOG_CALIBRATE_MAX < samples)
+        samples = EVLOG_CALIBRATE_MAX;
+
+    evlog_calibration_t cal;
+    cal.samples = samples;
+    calibrate_call(EVLOG_CAL_STAMP, samples, 0U, &cal.stamp);
+    for (uint32_t i = 0; i < 5U; i++)
+        calibrate_call(EVLOG_CAL_EVLOG1 + i, samples, cal.stamp.median, &cal.evlog[i]);
+
+    calibrate_call(EVLOG_CAL_DISABLED, samples, cal.stamp.median, &cal.disabled);
+    evlog_calibration = cal;
+    return true;
+}
+
+const evlog_calibration_t *evlog_get_calibration(void) {
+    return (0 == evlog_calibration.samples) ? NULL : &evlog_calibration;
+}
+
+/*
+  Calibrated cost of one log call in EVLOG_TIMESTAMP units, 0 until
+  evlog_calibrate() is run. The interval between two logged timestamps
+  includes about one call.
+*/
+uint32_t evlog_get_overhead(void) {
+    uint32_t cycles = evlog_calibration.evlog[4].median;
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+    return cycles;
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
+    return (cycles + clockCyclesPerMicrosecond() / 2U) / clockCyclesPerMicrosecond();
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    return (cycles + clockCyclesPerMicrosecond() * 500U) / (clockCyclesPerMicrosecond() * 1000U);
+#else
+    (void)cycles;
     return 0U;
+#endif
 }
 
-bool evlog_get_event(evlog_entry_t *entry, bool first) {
-    static struct {
-        uint32_t next;
-        uint32_t stop;
-    } event = {0, 0};
+static inline __attribute__((__always_inline__))
+const char *clock_fmt(void) {
+    return PSTR(EVLOG_CLOCK_FMT);
+}
 
-    if (!is_inited())
+/*
+  Returns false, logging nothing, while the time of day is not set.
+*/
+bool evlog_clock_sync(void) {
+    struct timeval tv;
+    if (0 != gettimeofday(&tv, NULL) || EVLOG_CLOCK_MIN_SEC > (uint32_t)tv.tv_sec)
         return false;
 
-    if (first) {
-        event.stop = p_evlog->num;
-        event.next = evlog_get_start_index();
-    } else
-    if (0 == event.next)
-        return false;
+    EVLOG3_P(clock_fmt(), (uint32_t)tv.tv_sec, (uint32_t)tv.tv_usec);
+    return true;
+}
 
-#ifdef EVLOG_CIRCULAR
-    if (MAX_EVENTS <= event.next)
-        event.next = 0;
+/*
+  Timestamp ticks to us, as ticks * mult >> shift, in two halves so that
+  neither product overflows.
+*/
+uint64_t evlog_ticks_to_us(uint64_t ticks) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+    uint64_t mult = ((uint64_t)1U << 32) / clockCyclesPerMicrosecond();
+    return (ticks >> 32) * mult + (((ticks & 0xFFFFFFFFU) * mult) >> 32);
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    return ticks * 1000U;
 #else
-    if (MAX_EVENTS <= event.next || 0 == event.stop)
-        return false;
+    return ticks;
 #endif
+}
 
-    if (entry)
-        *entry = p_evlog->event[event.next];
+/*
+  Set up `map` for a pass over the log, from the first clock record in it.
+  Returns false when there is none, and every evlog_clock_map_next() will
+  return false.
+*/
+bool evlog_clock_map_begin(evlog_clock_map_t *map) {
+    memset(map, 0, sizeof(*map));
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    uint32_t count = evlog_get_count();
+    evlog_entry_t event = evlog_entry_t();
+    bool more = true;
+    for (uint32_t i = 0; more && i < count && !map->valid; i++) {
+        more = evlog_get_event(&event, (0U == i));
+        uint64_t utc_us;
+        evlog_clock_map_next(map, &event, &utc_us);
+    }
+    bool valid = map->valid;
+    uint64_t anchor_now = map->anchor_now;
+    uint64_t anchor_us = map->anchor_us;
+    memset(map, 0, sizeof(*map));
+    map->valid = valid;
+    map->anchor_now = anchor_now;
+    map->anchor_us = anchor_us;
+#endif
+    return map->valid;
+}
 
-    event.next++;
+/*
+  Call for each entry in order. Gets the entry's UTC time in us since 1970,
+  returns false when it is not known.
+*/
+bool evlog_clock_map_next(evlog_clock_map_t *map, const evlog_entry_t *event, uint64_t *utc_us) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    if (map->index)
+        map->now += (uint32_t)(event->ts - map->last_ts);
+    map->last_ts = event->ts;
+    map->index++;
 
-    if (event.next == event.stop) {
-        event.next = 0;  // stop we are done
-        return false;
+#if (EVLOG_TOTAL_ARGS > 1)
+    if (clock_fmt() == event->fmt) {
+        map->anchor_now = map->now;
+        map->anchor_us = (uint64_t)event->data[0] * 1000000U;
+#if (EVLOG_TOTAL_ARGS > 2)
+        map->anchor_us += event->data[1];
+#endif
+        map->valid = true;
     }
+#endif
+    if (!map->valid)
+        return false;
 
+    if (map->now >= map->anchor_now)
+        *utc_us = map->anchor_us + evlog_ticks_to_us(map->now - map->anchor_now);
+    else
+        *utc_us = map->anchor_us - evlog_ticks_to_us(map->anchor_now - map->now);
     return true;
+#else
+    (void)map;
+    (void)event;
+    (void)utc_us;
+    return false;
+#endif
 }
 
 };
 
+#ifdef EVLOG_HOST
+// No flash on the host. PSTR() strings are plain .rodata within the executable.
+extern "C" const char __executable_start[];
+extern "C" const char end[];
+constexpr const char *pstr_area_start = &__executable_start[0];
+constexpr const char *pstr_area_end = &end[0];
+
+#else
 #include "Print.h"
 #if 0
 extern "C" const char _irom0_pstr_start[];
@@ -396,6 +576,7 @@ extern "C" const char _irom0_text_end[];
 constexpr const char *pstr_area_start = &_irom0_text_start[0];
 constexpr const char *pstr_area_end = &_irom0_text_end[0];
 #endif
+#endif
 /*
   Validate PSTR fmt pointers -  This is mainly needed to catch misaligned/bad
   pointers from a previous/different boot image.
@@ -407,9 +588,14 @@ bool isPstrFmt(const char *pStr) {
   if (pstr_area_end <= pStr)
     return false;
 
-  if (0 != ((uint32_t)pStr & 3U))
+  if (0 != ((uintptr_t)pStr & 3U))
     return false;
 
+#ifdef EVLOG_HOST
+  // Not zero padded on the host.
+  return true;
+#else
+
   if (pstr_area_start == pStr)
     return true;
 
@@ -425,69 +611,169 @@ bool isPstrFmt(const char *pStr) {
     return true;
 
   return false;
+#endif
+}
+
+/*
+  A 16-bit ID for a PSTR fmt, its word offset in the PSTR area plus one, for
+  compact formats that can not hold a pointer. IDs run 1 to
+  EVLOG_FMT_ID_MAX, which reaches the first 256 KB of the PSTR area. 0 when
+  fmt does not fit. Like fmt pointers, IDs are only good with the same
+  firmware image.
+*/
+uint16_t evlog_fmt_id(const char *fmt) {
+  if (pstr_area_start > fmt || pstr_area_end <= fmt || 0 != ((uintptr_t)fmt & 3U))
+    return 0U;
+
+  size_t id = (size_t)(fmt - pstr_area_start) / 4U + 1U;
+  return (EVLOG_FMT_ID_MAX < id) ? 0U : (uint16_t)id;
+}
+
+const char *evlog_id_fmt(uint16_t id) {
+  if (0U == id || EVLOG_FMT_ID_MAX < id)
+    return NULL;
+
+  const char *fmt = pstr_area_start + ((size_t)id - 1U) * 4U;
+  return (isPstrFmt(fmt)) ? fmt : NULL;
+}
+
+/*
+  Where the image is loaded. Binary dumps store fmt and code addresses
+  relative to it, so host tools can find them in the ELF file. 0 on the
+  ESP8266, where addresses are absolute.
+*/
+uintptr_t IRAM_OPTION evlog_image_base(void) {
+#ifdef EVLOG_HOST
+  return (uintptr_t)pstr_area_start;
+#else
+  return 0U;
+#endif
 }
 
 #define EVLOG_TIMESTAMP_CLOCKCYCLES   (80000000U)
 #define EVLOG_TIMESTAMP_MICROS        (1000000U)
 #define EVLOG_TIMESTAMP_MILLIS        (1000U)
 
-void evlogPrintReport(Print& out, bool bLocalTime) {
-  out.println(F("EvLog Report"));
+/*
+  "YYYY-MM-DD hh:mm:ss.uuuuuuZ", from days since 1970 by integer math.
+  http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+*/
+static void print_utc(EvlogBufferPrint& out, uint64_t utc_us) {
+  uint32_t usec = (uint32_t)(utc_us % 1000000U);
+  uint64_t secs = utc_us / 1000000U;
+  uint32_t sod = (uint32_t)(secs % 86400U);
+  uint32_t z = (uint32_t)(secs / 86400U) + 719468U;
+  uint32_t era = z / 146097U;
+  uint32_t doe = z - era * 146097U;
+  uint32_t yoe = (doe - doe / 1460U + doe / 36524U - doe / 146096U) / 365U;
+  uint32_t doy = doe - (365U * yoe + yoe / 4U - yoe / 100U);
+  uint32_t mp = (5U * doy + 2U) / 153U;
+  uint32_t day = doy - (153U * mp + 2U) / 5U + 1U;
+  uint32_t month = (mp < 10U) ? mp + 3U : mp - 9U;
+  uint32_t year = yoe + era * 400U + ((month <= 2U) ? 1U : 0U);
+  out.printf_P(PSTR("%04u-%02u-%02u %02u:%02u:%02u.%06uZ: "), year, month, day,
+      sod / 3600U, (sod / 60U) % 60U, sod % 60U, usec);
+}
+
+/*
+  The timestamp as time since boot. The CPU cycle count wraps in under a
+  minute, only seconds are shown for it; others show hh:mm:ss of the day.
+*/
+static void print_ts(EvlogBufferPrint& out, const evlog_entry_t& event) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+  uint32_t fraction = event.ts / clockCyclesPerMicrosecond();
+  out.printf_P(PSTR("%02u.%06u: "), (fraction / 1000000U) % 60U, fraction % 1000000U);
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+      (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
+  uint32_t secs = event.ts / 1000000U;
+  uint32_t fraction = event.ts % 1000000U;
+  const char *ts_fmt = PSTR("%02u:%02u:%02u.%06u: ");
+#else
+  uint32_t secs = event.ts / 1000U;
+  uint32_t fraction = event.ts % 1000U;
+  const char *ts_fmt = PSTR("%02u:%02u:%02u.%03u: ");
+#endif
+  out.printf_P(ts_fmt, (secs / 3600U) % 24U, (secs / 60U) % 60U, secs % 60U, fraction);
+#else
+  (void)out;
+  (void)event;
+#endif
+}
+
+/*
+  Events lost since the log was cleared, by fmt. Nothing when none were.
+*/
+static void print_drops(EvlogBufferPrint& out) {
+  evlog_drops_t drops;
+  evlog_get_drops(&drops);
+  if (0U == drops.dropped && 0U == drops.overwritten)
+    return;
+
+  out.print(F("EvLog lost "));
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+  evlog_entry_t first = evlog_entry_t();
+  first.ts = drops.first_ts;
+  out.print(F("from "));
+  print_ts(out, first);
+#endif
+  out.printf_P(PSTR("%u events, %u dropped with the log full, %u overwritten\r\n"),
+      drops.dropped + drops.overwritten, drops.dropped, drops.overwritten);
+  for (size_t i = 0; i < EVLOG_DROP_FMTS; i++) {
+    if (NULL == drops.fmt[i].fmt)
+      continue;
+    out.printf_P(PSTR("  %10u  "), drops.fmt[i].count);
+    if (isPstrFmt(drops.fmt[i].fmt)) {
+      out.print('"');
+      out.print(FPSTR(drops.fmt[i].fmt));
+      out.print('"');
+    } else {
+      out.printf_P(PSTR("< ? >, 0x%08X"), (uint32_t)(uintptr_t)drops.fmt[i].fmt);
+    }
+    out.print(F("\r\n"));
+  }
+  if (drops.other)
+    out.printf_P(PSTR("  %10u  other\r\n"), drops.other);
+}
+
+/*
+  Sampled call sites are only known when evlog_sample.cpp is linked in.
+*/
+const evlog_sample_site_t * __attribute__((weak)) evlog_sample_site(const char *fmt) {
+  (void)fmt;
+  return NULL;
+}
+
+/*
+  Lines are gathered in a stack buffer and written out in large writes, with
+  no String or heap use. See evlog_print.h.
+*/
+void evlogPrintReport(Print& printer, bool bLocalTime) {
+  char buf[EVLOG_REPORT_BUFFER];
+  EvlogBufferPrint out(printer, buf, sizeof(buf));
+  out.print(F("EvLog Report\r\n"));
+
+  // The pass for the first clock record is done once, up front.
+  evlog_clock_map_t clock;
+  bool wall_clock = bLocalTime && evlog_clock_map_begin(&clock);
 
   uint32_t count = 0;
-  for (bool more = true; (more) && (count<MAX_EVENTS); count++) {
-    evlog_entry_t event;
+  for (bool more = true; (more) && (count<evlog_get_max_events()); count++) {
+    evlog_entry_t event = evlog_entry_t();
     more = evlog_get_event(&event, (0 == count));
     if (0 == count && !more)
         break;
 
-    out.printf("  ");
+    out.print(F("  "));
 
-    (void)bLocalTime;
-#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
-    uint32_t fraction = event.ts;
-    fraction /= clockCyclesPerMicrosecond();
-    time_t gtime = (time_t)(fraction / 1000000U);
-    fraction %= 1000000;
-    const char *ts_fmt = PSTR("%s.%06u: ");
-    struct tm *tv = gmtime(&gtime);
-    char buf[4];
-    // if (bLocalTime) not a real option  with a 57 sec resolution
-    if (strftime(buf, sizeof(buf), "%S", tv) > 0) {
-        out.printf_P(ts_fmt, buf, fraction);
-    } else {
-        out.print(F("--->>> "));
-    }
-#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
-    uint32_t fraction = event.ts;
-    time_t gtime = (time_t)(fraction / 1000000U);
-    fraction %= 1000000;
-    const char *ts_fmt = PSTR("%s.%06u: ");
-    // TODO: Factor this out of the loop, create an adjustment value
-    // Leave to a later date, this needs a lot more thought.
-    // if (bLocalTime) {
-    //   time_t real_gtime;
-    //   time(&real_gtime);
-    //   time_t up_time = (time_t)(micros() / 1000000U);
-    //   gtime += real_gtime - up_time; // Adjust
-    // }
-    // if (strftime(buf, sizeof(buf), "%T", localtime(&gtime)) > 0) {
-#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
-    uint32_t fraction = event.ts;
-    time_t gtime = (time_t)(fraction / 1000U);
-    fraction %= 1000U;
-    const char *ts_fmt = PSTR("%s.%03u: ");
-#endif
-#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
-    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
-    // struct tm *tv = gmtime(&gtime); //localtime(&gtime)
-    char buf[10];
-    if (strftime(buf, sizeof(buf), "%T", gmtime(&gtime)) > 0) {
-        out.printf_P(ts_fmt, buf, fraction);
+    uint64_t utc_us;
+    if (wall_clock && evlog_clock_map_next(&clock, &event, &utc_us)) {
+        print_utc(out, utc_us);
     } else {
-        out.print(F("--->>> "));
+        print_ts(out, event);
     }
-#endif
 
     if (isPstrFmt(event.fmt)) {
         // TODO: Still getting into trouble with badly formated printf format
@@ -510,15 +796,46 @@ void evlogPrintReport(Print& out, bool bLocalTime) {
 #endif
         );
     } else {
-        out.printf_P(PSTR("< ? >, 0x%08X"), (uint32_t)event.fmt);
+        out.printf_P(PSTR("< ? >, 0x%08X"), (uint32_t)(uintptr_t)event.fmt);
         for (size_t i=0; i<EVLOG_DATA_MAX ; i++)
-            out.printf(PSTR(", 0x%08X"), event.data[i]);
+            out.printf_P(PSTR(", 0x%08X"), event.data[i]);
     }
-    out.println();
+    const evlog_sample_site_t *site = evlog_sample_site(event.fmt);
+    if (site)
+        out.printf_P(PSTR("  [sampled, %u of %u hits logged]"), site->logged, site->hits);
+    out.print(F("\r\n"));
+  }
+
+  out.printf_P(PSTR("%u Logged Events of a possible %u.\r\n"), count, evlog_get_max_events());
+  void *storage_base;
+  size_t storage_size;
+  evlog_storage_t storage_policy = evlog_get_storage(&storage_base, &storage_size);
+  out.print(F("EvLog storage: "));
+  if (EVLOG_STORAGE_DRAM == storage_policy)
+    out.print(F("DRAM reserve"));
+  else if (EVLOG_STORAGE_RTC == storage_policy)
+    out.print(F("RTC memory"));
+  else if (EVLOG_STORAGE_HEAP == storage_policy)
+    out.print(F("heap"));
+  else
+    out.print(F("user"));
+  out.printf_P(PSTR(" at 0x%08X, %u bytes\r\n"), (uint32_t)(uintptr_t)storage_base, (uint32_t)storage_size);
+  print_drops(out);
+}
+
+void evlogPrintCalibration(Print& out) {
+  const evlog_calibration_t *cal = evlog_get_calibration();
+  if (NULL == cal) {
+    out.println(F("EvLog Calibration: not run, see evlog_calibrate()"));
+    return;
   }
 
-  out.println(String(count) + F(" Logged Events of a possible ") + String(MAX_EVENTS) + '.');
-  out.println(String("EVLOG_ADDR_SZ = ") + (EVLOG_ADDR_SZ));
+  out.printf_P(PSTR("EvLog Calibration, %u samples, CPU cycles min/median/max\r\n"), cal->samples);
+  out.printf_P(PSTR("  timestamp read:  %u/%u/%u\r\n"), cal->stamp.min, cal->stamp.median, cal->stamp.max);
+  for (size_t i = 0; i < 5U; i++)
+    out.printf_P(PSTR("  EVLOG%u:          %u/%u/%u\r\n"), (uint32_t)(i + 1U), cal->evlog[i].min, cal->evlog[i].median, cal->evlog[i].max);
+  out.printf_P(PSTR("  EVLOG5 disabled: %u/%u/%u\r\n"), cal->disabled.min, cal->disabled.median, cal->disabled.max);
+  out.printf_P(PSTR("  Overhead per event, subtracted from span durations: %u\r\n"), evlog_get_overhead());
 }
 
 #endif // DISABLE_EVLOG
@@ -25,6 +25,14 @@
 // #define EVLOG_CIRCULAR
 #define EVLOG_WITH_DRAM 1
 
+/*
+  Each entry carries a sequence number and a check word, so a log resumed
+  with EVLOG_NOZERO_COOKIE can be rebuilt from its entries, and entries torn
+  by a reset during the write are marked. One more word an entry, and a few
+  cycles a store.
+*/
+// #define EVLOG_SALVAGE
+
 /*
     Timestamp options
 
@@ -45,8 +53,10 @@
 #define EVLOG_TIMESTAMP_MILLIS        (1000U)     // Wraps at 49D 17:02:47.295
 
 // Selected Timestamp option from above
+#ifndef EVLOG_TIMESTAMP
 #define EVLOG_TIMESTAMP     EVLOG_TIMESTAMP_CLOCKCYCLES
 // #undef EVLOG_TIMESTAMP
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -70,9 +80,52 @@ typedef struct _EVENT_LOG_ENTRY {
     (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
     uint32_t ts;
 #endif
+#ifdef EVLOG_SALVAGE
+    uint32_t check;     // Sequence number << 16 | 16-bit sum, written last
+#endif
 } evlog_entry_t;
 
+/*
+  Where the log lives, see evlog_set_storage().
+*/
+typedef enum _EVLOG_STORAGE {
+    EVLOG_STORAGE_DRAM = 0,   // Block taken from the heap at umm_static_reserve_addr. Survives a reboot.
+    EVLOG_STORAGE_RTC,        // User RTC memory past eboot's 128 bytes. Also survives deep sleep.
+    EVLOG_STORAGE_HEAP,       // malloc()ed, lost at reboot. A big log for a debug session.
+    EVLOG_STORAGE_USER        // Caller supplied memory
+} evlog_storage_t;
+
+#ifndef EVLOG_RTC_ADDR
+#define EVLOG_RTC_ADDR ((void *)0x60001280U)
+#endif
+#define EVLOG_RTC_SZ (512U - 128U)   // USER_RTC - EBOOT
+
+/*
+  Events lost, see evlog_get_drops(). The per fmt table is looked up by the
+  fmt address, EVLOG_DROP_FMTS must be a power of 2.
+*/
+#ifndef EVLOG_DROP_FMTS
+#define EVLOG_DROP_FMTS (8U)
+#endif
+
+typedef struct _EVLOG_DROP_FMT {
+    const char *fmt;
+    uint32_t count;
+} evlog_drop_fmt_t;
+
+typedef struct _EVLOG_DROPS {
+    uint32_t dropped;       // Not stored, linear log full
+    uint32_t overwritten;   // Oldest replaced, circular log
+    uint32_t first_ts;      // Timestamp at the first loss, 0 without timestamps
+    uint32_t other;         // Lost with a fmt that has no row
+    evlog_drop_fmt_t fmt[EVLOG_DROP_FMTS];
+} evlog_drops_t;
+
 void enable_evlog_at_link_time(void)  __attribute__((noinline));
+bool evlog_set_storage(evlog_storage_t storage, void *base, size_t size);
+evlog_storage_t evlog_get_storage(void **base, size_t *size);
+uint32_t evlog_init_at(evlog_storage_t storage, void *base, size_t size);
+void evlog_preinit_at(uint32_t new_state, evlog_storage_t storage, void *base, size_t size);
 uint32_t evlog_init(void);
 void evlog_preinit(uint32_t new_state);
 void evlog_restart(uint32_t state);
@@ -82,14 +135,31 @@ void evlog_clear(void);
 uint32_t evlog_set_state(uint32_t enable);
 uint32_t evlog_get_state(void);
 uint32_t evlog_get_count(void);
+void evlog_get_drops(evlog_drops_t *drops);
 void evlog_restart(uint32_t state);
 
-inline __attribute__((__always_inline__))
+/*
+  The selected EVLOG_TIMESTAMP, 0 when there is none.
+*/
+inline __attribute__((__always_inline__, no_instrument_function))
+uint32_t evlog_timestamp(void) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+    return esp_get_cycle_count();
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
+    return micros();
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    return millis();
+#else
+    return 0U;
+#endif
+}
+
+inline __attribute__((__always_inline__, no_instrument_function))
 uint32_t evlog_stop(void) {
   return evlog_set_state(evlog_get_state() & ~EVLOG_ENABLE_MASK);
 }
 
-inline __attribute__((__always_inline__))
+inline __attribute__((__always_inline__, no_instrument_function))
 uint32_t evlog_start(void) {
   return evlog_set_state(evlog_get_state() | 1);
 }
@@ -109,7 +179,7 @@ uint32_t evlog_event1(const char *fmt, uint32_t data);
 #endif
 
 #if (EVLOG_TOTAL_ARGS > 4)
-inline __attribute__((__always_inline__))
+inline __attribute__((__always_inline__, no_instrument_function))
 uint32_t evlog_event4(const char *fmt, uint32_t data0, uint32_t data1, uint32_t data2) {
   return evlog_event5(fmt, data0, data1, data2, 0);
 }
@@ -117,7 +187,7 @@ uint32_t evlog_event4(const char *fmt, uint32_t data0, uint32_t data1, uint32_t
 #endif
 
 #if (EVLOG_TOTAL_ARGS > 3)
-inline __attribute__((__always_inline__))
+inline __attribute__((__always_inline__, no_instrument_function))
 uint32_t evlog_event3(const char *fmt, uint32_t data0, uint32_t data1) {
   return evlog_event4(fmt, data0, data1, 0);
 }
@@ -125,7 +195,7 @@ uint32_t evlog_event3(const char *fmt, uint32_t data0, uint32_t data1) {
 #endif
 
 #if (EVLOG_TOTAL_ARGS > 2)
-inline __attribute__((__always_inline__))
+inline __attribute__((__always_inline__, no_instrument_function))
 uint32_t evlog_event2(const char *fmt, uint32_t data0) {
   return evlog_event3(fmt, data0, 0);
 }
@@ -133,7 +203,7 @@ uint32_t evlog_event2(const char *fmt, uint32_t data0) {
 #endif
 
 #if (EVLOG_TOTAL_ARGS > 1)
-inline __attribute__((__always_inline__))
+inline __attribute__((__always_inline__, no_instrument_function))
 uint32_t evlog_event1(const char *fmt) {
   return evlog_event2(fmt, 0);
 }
@@ -160,13 +230,104 @@ uint32_t evlog_event1(const char *fmt) {
 
 bool evlog_get_event(evlog_entry_t *entry, bool first);
 
+/*
+  For EvLog modules, keep interrupts out of a multi-word update. Use as a pair
+  within one block.
+*/
+#ifdef EVLOG_HOST
+#define EVLOG_INTR_LOCK() do {} while (false)
+#define EVLOG_INTR_UNLOCK() do {} while (false)
+#else
+#define EVLOG_INTR_LOCK() uint32_t saved_ps = xt_rsil(15)
+#define EVLOG_INTR_UNLOCK() xt_wsr_ps(saved_ps)
+#endif
+
+/*
+  Direct access by slot, for readers that follow the log as it is written.
+  `evlog_get_num()` returns the slot the last event went in plus one.
+  `evlog_get_generation()` changes when the log is cleared or placed, the
+  slots read before then are gone.
+*/
+uint32_t evlog_get_max_events(void);
+uint32_t evlog_get_num(bool *wrapped);
+uint32_t evlog_get_generation(void);
+bool evlog_get_event_at(uint32_t slot, evlog_entry_t *entry);
+
+/*
+  Self-benchmark of the logging calls, in CPU cycles from esp_get_cycle_count().
+  Each call is timed separately; the entry it writes is rolled back, so the log
+  content is left as it was. Call from a quiet context, an EVLOG from an ISR
+  during calibration can be lost.
+*/
+#ifndef EVLOG_CALIBRATE_MAX
+#define EVLOG_CALIBRATE_MAX (64U)     // Max samples per measurement
+#endif
+
+typedef struct _EVLOG_CYCLES {
+    uint32_t min;
+    uint32_t median;
+    uint32_t max;
+} evlog_cycles_t;
+
+typedef struct _EVLOG_CALIBRATION {
+    uint32_t samples;
+    evlog_cycles_t stamp;       // Back to back esp_get_cycle_count(), removed from the others
+    evlog_cycles_t evlog[5];    // EVLOG1 .. EVLOG5 writing an entry
+    evlog_cycles_t disabled;    // EVLOG5 with logging stopped
+} evlog_calibration_t;
+
+bool evlog_calibrate(uint32_t samples);
+const evlog_calibration_t *evlog_get_calibration(void);
+uint32_t evlog_get_overhead(void);
+
+/*
+  Wall clock calibration. evlog_clock_sync() logs a record pairing the
+  timestamp with the time of day, once the clock has been set. Call it at
+  each SNTP sync, e.g. `settimeofday_cb([]() { evlog_clock_sync(); });`.
+
+  A reader maps every entry to UTC from the clock record before it, or the
+  first one after it. Go through the entries in order with
+  evlog_clock_map_next(), after one evlog_clock_map_begin(). With CPU cycle
+  timestamps, gaps between entries must be shorter than the wrap time.
+*/
+#define EVLOG_CLOCK_FMT "EvClock %u.%06u UTC"
+#define EVLOG_CLOCK_MIN_SEC (1546300800U)   // 2019-01-01, earlier is a clock not set yet
+
+typedef struct _EVLOG_CLOCK_MAP {
+    uint64_t now;           // Unwrapped ticks from the first entry
+    uint64_t anchor_now;    // `now` at the clock record in use
+    uint64_t anchor_us;     // UTC there, us since 1970
+    uint32_t last_ts;
+    uint32_t index;
+    bool valid;
+} evlog_clock_map_t;
+
+bool evlog_clock_sync(void);
+bool evlog_clock_map_begin(evlog_clock_map_t *map);
+bool evlog_clock_map_next(evlog_clock_map_t *map, const evlog_entry_t *event, uint64_t *utc_us);
+uint64_t evlog_ticks_to_us(uint64_t ticks);
+
 #ifdef __cplusplus
 };
 #endif
 
+// The largest evlog_fmt_id(), 0xFFFF is left for evlog_rtc.h.
+#define EVLOG_FMT_ID_MAX (0xFFFEU)
+
+#ifdef __cplusplus
+bool isPstrFmt(const char *pStr);
+uint16_t evlog_fmt_id(const char *fmt);
+const char *evlog_id_fmt(uint16_t id);
+uintptr_t evlog_image_base(void);
+#endif
+
 #ifdef Print_h
 // void evlogPrintReport(Print& out);
+// bLocalTime prints UTC wall clock time, from evlog_clock_sync() records
 void evlogPrintReport(Print& out, bool bLocalTime = false);
+void evlogPrintCalibration(Print& out);
+bool evlogWriteDump(Print& out);
+size_t evlogWriteCompressed(Print& out, bool lz = true);
 #endif
 
 #define EVLOG5(fmt, val0, val1, val2, val3)  EVLOG5_P(PSTR(fmt), (val0), (val1), (val2), (val3))
@@ -175,13 +336,20 @@ void evlogPrintReport(Print& out, bool bLocalTime = false);
 #define EVLOG2(fmt, val0) EVLOG2_P(PSTR(fmt), (val0))
 #define EVLOG1(fmt) EVLOG1_P(PSTR(fmt))
 
-#else // ! EVLOG_ENABLE
+#elif !defined(EVLOG_ENABLE) && !defined(EVENT_LOGGER_STUBS_H) // ! EVLOG_ENABLE
+#define EVENT_LOGGER_STUBS_H
 #ifndef evlog_init
 #define evlog_init(a) do{}while(false)
 #endif
 #ifndef evlog_restart
 #define evlog_restart(state) do{}while(false)
 #endif
+#ifndef evlog_calibrate
+#define evlog_calibrate(samples) (false)
+#endif
+#ifndef evlog_clock_sync
+#define evlog_clock_sync() (false)
+#endif
 #ifdef Print_h
 #ifndef evlogPrintReport
 // #define evlogPrintReport(out) do{}while(false)
@@ -191,6 +359,27 @@ void evlogPrintReport(Print& out, bool bLocalTime = false) {
   (void)bLocalTime;
 }
 #endif
+#ifndef evlogPrintCalibration
+inline __attribute__((__always_inline__))
+void evlogPrintCalibration(Print& out) {
+  (void)out;
+}
+#endif
+#ifndef evlogWriteDump
+inline __attribute__((__always_inline__))
+bool evlogWriteDump(Print& out) {
+  (void)out;
+  return false;
+}
+#endif
+#ifndef evlogWriteCompressed
+inline __attribute__((__always_inline__))
+size_t evlogWriteCompressed(Print& out, bool lz = true) {
+  (void)out;
+  (void)lz;
+  return 0;
+}
+#endif
 #endif
 #ifndef EVLOG5
 #define EVLOG5_P(fmt, val0, val1, val2, val3) do{ (void)fmt; (void)val0; (void)val1; (void)val2; (void)val3; }while(false)
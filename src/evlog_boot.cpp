@@ -0,0 +1,250 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Boot phase timing, see evlog_boot.h.
+
+    Times come from system_get_time(), the 1 MHz WDEV timer that starts at
+    reset. It runs before the SDK is up, so the first milestone also gives
+    the time spent in the ROM loader and eboot.
+
+    Flash reads are the SPIRead() calls counted by flash_stats.cpp. A cache
+    miss on code in flash is not a SPIRead() and is not counted.
+
+    Nothing here may live in .bss. The SDK clears it after app_entry, which
+    would undo evlog_boot_begin(). All state is in the history.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#include "user_interface.h"
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <evlog/src/evlog_boot.h>
+
+#ifdef EVLOG_BOOT_H
+#ifdef EVLOG_ENABLE
+
+#ifndef EVLOG_HOST
+#include <evlog/src/flash_stats.h>
+#endif
+
+extern "C" {
+#define IRAM_OPTION ICACHE_RAM_ATTR
+
+#ifdef EVLOG_BOOT_ADDR
+static volatile evlog_boot_history_t * const p_boot = (volatile evlog_boot_history_t *)EVLOG_BOOT_ADDR;
+#else
+static evlog_boot_history_t boot_history __attribute__((section(".noinit")));
+static volatile evlog_boot_history_t * const p_boot = &boot_history;
+#endif
+
+#define EVLOG_BOOT_LAYOUT (EVLOG_BOOT_HISTORY << 8 | EVLOG_BOOT_MARKS)
+#define EVLOG_BOOT_COOKIE ((uint32_t)((((uintptr_t)p_boot ^ EVLOG_BOOT_LAYOUT) << 1) | 1U))
+
+static inline __attribute__((__always_inline__))
+uint32_t boot_now(void) {
+#ifdef EVLOG_HOST
+    return micros();
+#else
+    return system_get_time();
+#endif
+}
+
+static inline __attribute__((__always_inline__))
+uint32_t boot_flash_reads(void) {
+#if defined(ENABLE_FLASH_STATS) && ENABLE_FLASH_STATS
+    return flash_log.r_count.all;
+#else
+    return 0U;
+#endif
+}
+
+static void IRAM_OPTION boot_zero(volatile uint32_t *p, size_t size) {
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++)
+        p[i] = 0U;
+}
+
+void IRAM_OPTION evlog_boot_clear(void) {
+    boot_zero((volatile uint32_t *)p_boot, sizeof(evlog_boot_history_t));
+    p_boot->cookie = EVLOG_BOOT_COOKIE;
+}
+
+/*
+  Starts the record of a new boot, dropping the oldest, and marks
+  EVLOG_BOOT_APP_ENTRY. Call once per boot, as early as possible.
+*/
+void IRAM_OPTION evlog_boot_begin(void) {
+    if (EVLOG_BOOT_COOKIE != p_boot->cookie)
+        evlog_boot_clear();
+
+    uint32_t boots = p_boot->boots + 1U;
+    uint32_t current = p_boot->current + 1U;
+    if (current >= EVLOG_BOOT_HISTORY || 1U == boots)
+        current = 0U;
+
+    volatile evlog_boot_record_t *record = &p_boot->record[current];
+    boot_zero((volatile uint32_t *)record, sizeof(evlog_boot_record_t));
+    record->reason = ~0U;
+    record->boot = boots;
+    p_boot->boots = boots;
+    p_boot->current = current;
+    p_boot->last_reads = 0U;
+    evlog_boot_mark(EVLOG_BOOT_APP_ENTRY);
+}
+
+void IRAM_OPTION evlog_boot_mark(uint32_t mark) {
+    if (EVLOG_BOOT_MARKS <= mark || EVLOG_BOOT_COOKIE != p_boot->cookie)
+        return;
+
+    volatile evlog_boot_record_t *record = &p_boot->record[p_boot->current];
+    uint32_t bit = 1U << mark;
+    if (record->marked & bit)
+        return;
+
+    uint32_t us = boot_now();
+    uint32_t reads = boot_flash_reads();
+    uint32_t last_reads = p_boot->last_reads;
+    // flash_stats.cpp restarts its counters when the flash size changes.
+    record->reads[mark] = (reads >= last_reads) ? reads - last_reads : reads;
+    p_boot->last_reads = reads;
+    record->us[mark] = us;
+    record->marked |= bit;
+#ifndef EVLOG_HOST
+    // The SDK has the reset reason from user_init() on.
+    if (~0U == record->reason && EVLOG_BOOT_USER_INIT <= mark)
+        record->reason = system_get_rst_info()->reason;
+#else
+    record->reason = 0U;
+#endif
+    EVLOG3("*** Boot milestone %u, %u us since reset", mark, us);
+}
+
+/*
+  Copies the record of the boot `back` boots ago, 0 for this one. Returns
+  its boot count, or 0 when it is not kept.
+*/
+uint32_t evlog_boot_get(uint32_t back, evlog_boot_record_t *record) {
+    if (EVLOG_BOOT_COOKIE != p_boot->cookie ||
+        back >= EVLOG_BOOT_HISTORY || back >= p_boot->boots)
+        return 0U;
+
+    uint32_t n = p_boot->current + EVLOG_BOOT_HISTORY - back;
+    if (n >= EVLOG_BOOT_HISTORY)
+        n -= EVLOG_BOOT_HISTORY;
+
+    const volatile uint32_t *from = (const volatile uint32_t *)&p_boot->record[n];
+    uint32_t *to = (uint32_t *)record;
+    for (size_t i = 0; i < sizeof(evlog_boot_record_t) / sizeof(uint32_t); i++)
+        to[i] = from[i];
+    return record->boot;
+}
+
+};
+
+static const char *mark_name(uint32_t mark) {
+  switch (mark) {
+    case EVLOG_BOOT_APP_ENTRY: return PSTR("app_entry");
+    case EVLOG_BOOT_SDK_START: return PSTR("sdk_start");
+    case EVLOG_BOOT_USER_INIT: return PSTR("user_init");
+    case EVLOG_BOOT_PREINIT:   return PSTR("preinit");
+    case EVLOG_BOOT_WIFI:      return PSTR("wifi");
+    case EVLOG_BOOT_SETUP:     return PSTR("setup");
+    default:                   return PSTR("loop");
+  }
+}
+
+static void print_name(Print& out, uint32_t mark, size_t width) {
+  const char *name = mark_name(mark);
+  for (size_t len = strlen_P(name); len < width; len++)
+    out.print(' ');
+  out.print(FPSTR(name));
+}
+
+/*
+  This boot, milestones in the order reached, each with the time and flash
+  reads since the one before. Then the history, newest first, and the mean
+  of the earlier boots.
+*/
+void evlogPrintBootReport(Print& out) {
+  evlog_boot_record_t record;
+  if (0U == evlog_boot_get(0, &record)) {
+    out.printf_P(PSTR("EvLog Boot, no record\r\n"));
+    return;
+  }
+
+  out.printf_P(PSTR("EvLog Boot #%u, reset reason %d\r\n"), record.boot, (int)record.reason);
+  out.printf_P(PSTR("  %10s %12s %10s %8s\r\n"), "milestone", "us", "+us", "reads");
+  uint32_t done = 0U, last_us = 0U;
+  for (;;) {
+    // Next milestone by time, WiFi may come before or after setup().
+    uint32_t mark = EVLOG_BOOT_MARKS;
+    for (uint32_t i = 0; i < EVLOG_BOOT_MARKS; i++) {
+      if ((record.marked & ~done & (1U << i)) &&
+          (EVLOG_BOOT_MARKS == mark || record.us[i] < record.us[mark]))
+        mark = i;
+    }
+    if (EVLOG_BOOT_MARKS == mark)
+      break;
+
+    done |= 1U << mark;
+    out.print(F("  "));
+    print_name(out, mark, 10U);
+    out.printf_P(PSTR(" %12u %10u %8u\r\n"), record.us[mark], record.us[mark] - last_us, record.reads[mark]);
+    last_us = record.us[mark];
+  }
+
+  out.printf_P(PSTR("EvLog Boot History, us since reset, newest first\r\n"));
+  out.printf_P(PSTR("  %6s %3s"), "boot", "rst");
+  for (uint32_t i = 0; i < EVLOG_BOOT_MARKS; i++) {
+    out.print(' ');
+    print_name(out, i, 10U);
+  }
+  out.println();
+
+  uint64_t sum[EVLOG_BOOT_MARKS] = {0};
+  uint32_t count[EVLOG_BOOT_MARKS] = {0};
+  for (uint32_t back = 0; evlog_boot_get(back, &record); back++) {
+    out.printf_P(PSTR("  %6u %3d"), record.boot, (int)record.reason);
+    for (uint32_t i = 0; i < EVLOG_BOOT_MARKS; i++) {
+      if (record.marked & (1U << i)) {
+        out.printf_P(PSTR(" %10u"), record.us[i]);
+        if (back) {
+          sum[i] += record.us[i];
+          count[i]++;
+        }
+      } else {
+        out.printf_P(PSTR(" %10s"), "-");
+      }
+    }
+    out.println();
+  }
+
+  out.printf_P(PSTR("  %10s"), "mean");
+  for (uint32_t i = 0; i < EVLOG_BOOT_MARKS; i++) {
+    if (count[i])
+      out.printf_P(PSTR(" %10u"), (uint32_t)(sum[i] / count[i]));
+    else
+      out.printf_P(PSTR(" %10s"), "-");
+  }
+  out.println();
+}
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_BOOT_H
@@ -0,0 +1,114 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Boot phase timing. Each milestone of a boot is stamped once, in
+  microseconds since reset, with the flash reads done since the milestone
+  before it. The last EVLOG_BOOT_HISTORY boots are kept, to spot a boot that
+  got slower.
+
+  With ENABLE_EVLOG_MAIN, evlog_main.cpp calls evlog_boot_begin() from
+  app_entry_redefinable() and marks EVLOG_BOOT_SDK_START and
+  EVLOG_BOOT_USER_INIT. The rest are marked by the sketch:
+
+    void preinit() { evlog_boot_mark(EVLOG_BOOT_PREINIT); ... }
+    end of setup():  evlog_boot_mark(EVLOG_BOOT_SETUP);
+    top of loop():   evlog_boot_mark(EVLOG_BOOT_LOOP);
+    WiFi got IP:     evlog_boot_mark(EVLOG_BOOT_WIFI);
+
+  Only the first mark of each milestone counts, the rest return at once.
+  Without evlog_main.cpp, call evlog_boot_begin() first thing in preinit().
+
+  The history is in .noinit DRAM, kept over a restart or crash but not deep
+  sleep. To keep it over deep sleep, set EVLOG_BOOT_ADDR to User RTC memory
+  not used by anything else. It is only read and written by 32-bit word.
+*/
+#if !defined(EVLOG_BOOT_H) && defined(EVLOG_ENABLE)
+#define EVLOG_BOOT_H
+
+#include <evlog/src/event_logger.h>
+
+#ifndef EVLOG_BOOT_HISTORY
+#define EVLOG_BOOT_HISTORY (8U)     // Boots kept, the current one included
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum _EVLOG_BOOT_MARK {
+    EVLOG_BOOT_APP_ENTRY = 0,   // ROM and eboot done, app_entry_redefinable()
+    EVLOG_BOOT_SDK_START,       // call_user_start(), into the NONOS SDK
+    EVLOG_BOOT_USER_INIT,       // The SDK calls user_init()
+    EVLOG_BOOT_PREINIT,         // preinit()
+    EVLOG_BOOT_WIFI,            // Station connected and got an IP address
+    EVLOG_BOOT_SETUP,           // setup() done
+    EVLOG_BOOT_LOOP,            // First loop()
+    EVLOG_BOOT_MARKS
+} evlog_boot_mark_t;
+
+typedef struct _EVLOG_BOOT_RECORD {
+    uint32_t boot;                      // Boot count, 0 for none
+    uint32_t reason;                    // rst_info reason, ~0U until known
+    uint32_t marked;                    // Bit per milestone reached
+    uint32_t us[EVLOG_BOOT_MARKS];      // Since reset
+    uint32_t reads[EVLOG_BOOT_MARKS];   // Flash reads since the milestone before
+} evlog_boot_record_t;
+
+typedef struct _EVLOG_BOOT_HISTORY {
+    uint32_t cookie;
+    uint32_t boots;
+    uint32_t current;                   // Record of this boot
+    uint32_t last_reads;                // Flash reads at the last mark
+    evlog_boot_record_t record[EVLOG_BOOT_HISTORY];
+} evlog_boot_history_t;
+
+void evlog_boot_begin(void);
+void evlog_boot_mark(uint32_t mark);
+void evlog_boot_clear(void);
+uint32_t evlog_boot_get(uint32_t back, evlog_boot_record_t *record);
+
+#ifdef __cplusplus
+};
+#endif
+
+#ifdef Print_h
+void evlogPrintBootReport(Print& out);
+#endif
+
+#elif !defined(EVLOG_BOOT_H)
+#define EVLOG_BOOT_H
+// Marks left in the sketch still compile.
+typedef enum _EVLOG_BOOT_MARK {
+    EVLOG_BOOT_APP_ENTRY = 0,
+    EVLOG_BOOT_SDK_START,
+    EVLOG_BOOT_USER_INIT,
+    EVLOG_BOOT_PREINIT,
+    EVLOG_BOOT_WIFI,
+    EVLOG_BOOT_SETUP,
+    EVLOG_BOOT_LOOP,
+    EVLOG_BOOT_MARKS
+} evlog_boot_mark_t;
+#define evlog_boot_begin() do{}while(false)
+#define evlog_boot_mark(mark) do{ (void)(mark); }while(false)
+#define evlog_boot_clear() do{}while(false)
+#define evlog_boot_get(back, record) (0U)
+#ifdef Print_h
+inline __attribute__((__always_inline__))
+void evlogPrintBootReport(Print& out) {
+  (void)out;
+}
+#endif
+#endif
@@ -0,0 +1,281 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Binary dump of the event log, plain or compressed, see evlog_dump.h for
+    the formats.
+
+    Send it anywhere a Print goes, e.g. evlogWriteDump(Serial) to capture
+    on a PC, or to a File. Logging is stopped while the dump is written.
+
+    evlogWriteCompressed() needs about 700 bytes of stack for the LZ stage
+    and the fmt dictionary.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#include <Print.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_dump.h>
+#include <evlog/src/evlog_print.h>
+
+#ifdef EVENT_LOGGER_H
+
+static uint32_t dump_ts_hz(void) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+    return clockCyclesPerMicrosecond() * 1000000U;
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+      (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    return EVLOG_TIMESTAMP;
+#else
+    return 0U;
+#endif
+}
+
+static void dump_header(evlog_dump_header_t *hdr, uint32_t magic) {
+    bool wrapped = false;
+    evlog_get_num(&wrapped);
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = magic;
+    hdr->version = EVLOG_DUMP_VERSION;
+    hdr->data_count = EVLOG_DATA_MAX;
+    hdr->ts_hz = dump_ts_hz();
+    hdr->has_ts = (0U != hdr->ts_hz) ? 1U : 0U;
+    hdr->flags = (wrapped) ? EVLOG_DUMP_F_WRAPPED : 0U;
+#ifdef EVLOG_CIRCULAR
+    hdr->flags |= EVLOG_DUMP_F_CIRCULAR;
+#endif
+    hdr->count = evlog_get_count();
+    hdr->max_events = evlog_get_max_events();
+    hdr->overhead = evlog_get_overhead();
+    hdr->image_base = evlog_image_base();
+}
+
+typedef struct _DUMP_ITER {
+    uint32_t index;
+    bool more;
+} dump_iter_t;
+
+/*
+  The next entry as dump words: fmt offset, data, and ts when there is one.
+  Past the end of a short log the entries are all zero, so the header count
+  holds. Returns the number of words.
+*/
+static size_t next_entry(dump_iter_t *it, uintptr_t base, uint32_t *words) {
+    evlog_entry_t event;
+    memset(&event, 0, sizeof(event));
+    // evlog_get_event() returns false with the last entry.
+    if (it->more)
+        it->more = evlog_get_event(&event, (0U == it->index));
+    it->index++;
+
+    size_t n = 0;
+    words[n++] = (event.fmt) ? (uint32_t)((uintptr_t)event.fmt - base) : 0U;
+    for (size_t i = 0; i < EVLOG_DATA_MAX; i++)
+        words[n++] = event.data[i];
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    words[n++] = event.ts;
+#endif
+    return n;
+}
+
+/*
+  The sections after the entries, the same for both formats.
+*/
+static bool write_sections(Print& out) {
+    evlog_drops_t drops;
+    evlog_get_drops(&drops);
+    uint32_t words[EVLOG_DUMP_DROPS_WORDS + 2U * EVLOG_DROP_FMTS];
+    size_t n = 0;
+    words[n++] = drops.dropped;
+    words[n++] = drops.overwritten;
+    words[n++] = drops.first_ts;
+    words[n++] = drops.other;
+    n++;
+    for (size_t i = 0; i < EVLOG_DROP_FMTS; i++) {
+        if (NULL == drops.fmt[i].fmt)
+            continue;
+        words[n++] = (uint32_t)((uintptr_t)drops.fmt[i].fmt - evlog_image_base());
+        words[n++] = drops.fmt[i].count;
+    }
+    words[EVLOG_DUMP_DROPS_WORDS - 1U] = (uint32_t)(n - EVLOG_DUMP_DROPS_WORDS) / 2U;
+    evlog_dump_section_t sec = { EVLOG_DUMP_TAG_DROPS, (uint32_t)(n * sizeof(uint32_t)) };
+    bool ok = (sizeof(sec) == out.write((const uint8_t *)&sec, sizeof(sec)));
+    ok = ok && (sec.length == out.write((const uint8_t *)words, sec.length));
+
+    evlog_dump_section_t end = { EVLOG_DUMP_TAG_END, 0U };
+    return ok && (sizeof(end) == out.write((const uint8_t *)&end, sizeof(end)));
+}
+
+bool evlogWriteDump(Print& out) {
+    uint32_t state = evlog_stop();
+    evlog_dump_header_t hdr;
+    dump_header(&hdr, EVLOG_DUMP_MAGIC);
+    bool ok = (sizeof(hdr) == out.write((const uint8_t *)&hdr, sizeof(hdr)));
+
+    dump_iter_t it = { 0U, true };
+    for (uint32_t i = 0; ok && i < hdr.count; i++) {
+        uint32_t words[1U + EVLOG_DATA_MAX + 1U];
+        size_t n = next_entry(&it, (uintptr_t)hdr.image_base, words);
+        ok = (n * sizeof(uint32_t) == out.write((const uint8_t *)words, n * sizeof(uint32_t)));
+    }
+    ok = ok && write_sections(out);
+
+    evlog_set_state(state);
+    return ok;
+}
+
+/*
+  The optional LZ stage of evlogWriteCompressed(). Greedy, with a brute
+  force search of the last EVLOG_PACK_LZ_WINDOW bytes, and no state beyond
+  this object.
+*/
+class LzPrint : public Print {
+public:
+    LzPrint(Print& out) : out(out) {}
+    using Print::write;
+    size_t write(uint8_t c) override {
+        buf[len++] = c;
+        while (len - pos >= EVLOG_PACK_LZ_MAX)
+            step(EVLOG_PACK_LZ_MAX);
+        if (sizeof(buf) == len)
+            slide();
+        return 1U;
+    }
+
+    void finish(void) {
+        while (pos < len)
+            step(len - pos);
+        flush();
+    }
+
+private:
+    void step(size_t max) {
+        size_t best = 0, dist = 0;
+        size_t from = (pos > EVLOG_PACK_LZ_WINDOW) ? pos - EVLOG_PACK_LZ_WINDOW : 0U;
+        for (size_t c = from; c < pos && best < max; c++) {
+            size_t n = 0;
+            // May run on past pos, the decoder copies byte by byte too.
+            while (n < max && buf[c + n] == buf[pos + n])
+                n++;
+            if (n > best) {
+                best = n;
+                dist = pos - c;
+            }
+        }
+        if (EVLOG_PACK_LZ_MIN <= best) {
+            flush();
+            out.write((uint8_t)(0x80U | (best - EVLOG_PACK_LZ_MIN)));
+            out.write((uint8_t)(dist - 1U));
+            pos += best;
+        } else {
+            lit[nlit++] = buf[pos++];
+            if (sizeof(lit) == nlit)
+                flush();
+        }
+    }
+
+    void flush(void) {
+        if (nlit) {
+            out.write((uint8_t)(nlit - 1U));
+            out.write(lit, nlit);
+            nlit = 0;
+        }
+    }
+
+    // Keep the window before pos and the lookahead after it.
+    void slide(void) {
+        size_t drop = pos - EVLOG_PACK_LZ_WINDOW;
+        memmove(buf, buf + drop, len - drop);
+        len -= drop;
+        pos -= drop;
+    }
+
+    Print& out;
+    uint8_t buf[EVLOG_PACK_LZ_WINDOW + 2U * EVLOG_PACK_LZ_MAX];
+    size_t len = 0;
+    size_t pos = 0;
+    uint8_t lit[EVLOG_PACK_LZ_LITERALS];
+    size_t nlit = 0;
+};
+
+static void put_varint(Print& out, uint32_t value) {
+    while (0x80U <= value) {
+        out.write((uint8_t)(value | 0x80U));
+        value >>= 7;
+    }
+    out.write((uint8_t)value);
+}
+
+/*
+  Returns the bytes written, 0 when `out` did not take all of it.
+*/
+size_t evlogWriteCompressed(Print& out, bool lz) {
+    uint32_t state = evlog_stop();
+    evlog_dump_header_t hdr;
+    dump_header(&hdr, EVLOG_PACK_MAGIC);
+    if (lz)
+        hdr.flags |= EVLOG_DUMP_F_LZ;
+
+    EvlogCountPrint counted(out);
+    counted.write((const uint8_t *)&hdr, sizeof(hdr));
+    LzPrint packed(counted);
+    Print& body = (lz) ? (Print&)packed : (Print&)counted;
+
+    uint32_t dict[EVLOG_PACK_DICT];
+    size_t dict_count = 0;
+    uint32_t last_ts = 0;
+    dump_iter_t it = { 0U, true };
+    for (uint32_t i = 0; counted.ok && i < hdr.count; i++) {
+        uint32_t words[1U + EVLOG_DATA_MAX + 1U];
+        next_entry(&it, (uintptr_t)hdr.image_base, words);
+
+        size_t code = 0;
+        while (code < dict_count && dict[code] != words[0])
+            code++;
+        if (code < dict_count) {
+            put_varint(body, code + 1U);
+        } else {
+            put_varint(body, 0U);
+            put_varint(body, words[0]);
+            if (EVLOG_PACK_DICT > dict_count)
+                dict[dict_count++] = words[0];
+        }
+        if (hdr.has_ts) {
+            uint32_t ts = words[1U + EVLOG_DATA_MAX];
+            put_varint(body, ts - last_ts);
+            last_ts = ts;
+        }
+        for (size_t d = 1; d <= EVLOG_DATA_MAX; d++)
+            put_varint(body, (words[d] << 1) ^ (uint32_t)((int32_t)words[d] >> 31));
+    }
+    write_sections(body);
+    if (lz)
+        packed.finish();
+
+    evlog_set_state(state);
+    return (counted.ok) ? counted.count : 0U;
+}
+
+#endif // EVENT_LOGGER_H
@@ -0,0 +1,119 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Binary dump of the event log, for the host tools.
+
+  Little endian, 32-bit words:
+
+    evlog_dump_header_t
+    `count` entries, oldest first, each:
+        fmt offset              fmt - image_base
+        data[data_count]
+        ts                      when has_ts
+    sections, each:
+        evlog_dump_section_t    tag and length in bytes
+        payload                 padded to a multiple of 4 bytes
+    EVLOG_DUMP_TAG_END section
+
+  fmt and code addresses are stored relative to `image_base`, so a host tool
+  can look them up in the writer's ELF file. Tools skip sections they do not
+  know.
+
+  Sections:
+
+    EVLOG_DUMP_TAG_DROPS    events lost since the log was cleared, from
+                            evlog_get_drops():
+        dropped                 not stored, linear log full
+        overwritten             oldest replaced, circular log
+        first_ts                timestamp at the first loss
+        other                   lost with a fmt not in the table
+        rows
+        rows times:
+            fmt offset          fmt - image_base
+            count
+
+  This header only holds the format, host tools include it on its own.
+  evlogWriteDump() writes one.
+
+  evlogWriteCompressed() writes the same content packed, EVLOG_PACK_MAGIC in
+  the header, for slow links. After the header, the body is:
+
+    each entry:
+        fmt                     varint, 1 + index into the fmt dictionary,
+                                or 0 followed by the varint fmt offset, which
+                                is added to the dictionary while there is room
+        ts                      when has_ts, varint of the ticks since the
+                                previous entry, the first from 0
+        data[data_count]        zigzag varint each
+    sections, as in a dump
+
+  Varints are 7 bits a byte, low first, high bit set on all but the last.
+  With EVLOG_DUMP_F_LZ the body is further LZ coded as a series of:
+
+    0x00..0x7F              n + 1 literal bytes follow
+    0x80..0xFF, d           copy n - 0x80 + EVLOG_PACK_LZ_MIN bytes from
+                            d + 1 bytes back, may overlap
+
+  host/evlog_unpack turns it back into a plain dump.
+*/
+#ifndef EVLOG_DUMP_H
+#define EVLOG_DUMP_H
+
+#include <stdint.h>
+
+#define EVLOG_DUMP_MAGIC (0x644C7645U)  // "EvLd"
+#define EVLOG_DUMP_VERSION (1U)
+
+#define EVLOG_DUMP_TAG_END (0U)
+#define EVLOG_DUMP_TAG_DROPS (1U)
+
+#define EVLOG_DUMP_DROPS_WORDS (5U)   // Ahead of the rows
+
+typedef struct _EVLOG_DUMP_HEADER {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t data_count;     // EVLOG_DATA_MAX of the writer
+    uint8_t has_ts;
+    uint8_t flags;          // EVLOG_DUMP_F_...
+    uint32_t ts_hz;         // Timestamp ticks per second, 0 with no timestamp
+    uint32_t count;         // Entries that follow
+    uint32_t max_events;    // Capacity of the log
+    uint32_t overhead;      // evlog_get_overhead(), in timestamp ticks
+    uint64_t image_base;
+} evlog_dump_header_t;
+
+#define EVLOG_DUMP_F_WRAPPED  (1U)
+#define EVLOG_DUMP_F_CIRCULAR (2U)
+#define EVLOG_DUMP_F_LZ       (4U)   // Packed only
+
+#define EVLOG_PACK_MAGIC (0x704C7645U)  // "EvLp"
+
+#ifndef EVLOG_PACK_DICT
+#define EVLOG_PACK_DICT (64U)        // Writer's fmt dictionary entries
+#endif
+#ifndef EVLOG_PACK_LZ_WINDOW
+#define EVLOG_PACK_LZ_WINDOW (256U)  // Writer's match search, at most 256
+#endif
+#define EVLOG_PACK_LZ_MIN (3U)
+#define EVLOG_PACK_LZ_MAX (EVLOG_PACK_LZ_MIN + 0x7FU)
+#define EVLOG_PACK_LZ_LITERALS (0x80U)
+
+typedef struct _EVLOG_DUMP_SECTION {
+    uint32_t tag;
+    uint32_t length;
+} evlog_dump_section_t;
+
+#endif // EVLOG_DUMP_H
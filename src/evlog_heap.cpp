@@ -0,0 +1,236 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    The --wrap heap hooks, see evlog_heap.h.
+
+    With tracing off a hook is the real call and one test of a flag. The
+    counters are updated with interrupts off, as free() is called from ISRs.
+    The record is an EVLOG4_P or EVLOG5_P after the real call, so it holds
+    the pointer the allocator returned.
+
+    The log itself never allocates, except at evlog_init() with
+    EVLOG_STORAGE_HEAP, before logging is started.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#include <malloc.h>
+#else
+#include <Arduino.h>
+#include "user_interface.h"
+#include <umm_malloc/umm_malloc_cfg.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <evlog/src/evlog_heap.h>
+
+#ifdef EVLOG_HEAP_H
+#ifdef EVLOG_ENABLE
+
+extern "C" {
+#define IRAM_OPTION ICACHE_RAM_ATTR
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static volatile uint32_t trace_flags = 0;
+static evlog_heap_stats_t heap_stats;
+
+static inline __attribute__((__always_inline__))
+const char *alloc_fmt(void) {
+    return PSTR(EVLOG_HEAP_ALLOC_FMT);
+}
+
+static inline __attribute__((__always_inline__))
+const char *free_fmt(void) {
+    return PSTR(EVLOG_HEAP_FREE_FMT);
+}
+
+static inline __attribute__((__always_inline__))
+const char *realloc_fmt(void) {
+    return PSTR(EVLOG_HEAP_REALLOC_FMT);
+}
+
+// Sizes are logged as 32 bits, larger host requests saturate.
+static inline __attribute__((__always_inline__))
+uint32_t IRAM_OPTION size32(size_t size) {
+    return (size > (size_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)size;
+}
+
+// count * size of a calloc(), saturated as size32().
+static inline __attribute__((__always_inline__))
+uint32_t IRAM_OPTION calloc_size(size_t count, size_t size) {
+    size_t bytes;
+    if (__builtin_mul_overflow(count, size, &bytes))
+        return UINT32_MAX;
+    return size32(bytes);
+}
+
+static inline __attribute__((__always_inline__))
+uint32_t IRAM_OPTION size_class(uint32_t size) {
+    uint32_t bin = (0U == size) ? 0U : 32U - (uint32_t)__builtin_clz(size);
+    return (bin < EVLOG_HEAP_CLASSES) ? bin : EVLOG_HEAP_CLASSES - 1U;
+}
+
+/*
+  All the allocator has handed out, blocks from before tracing started too.
+  On the host that is glibc's count, which walks its free lists, tracing
+  there is for tests and tools.
+*/
+#ifdef EVLOG_HOST
+static inline size_t host_heap_used(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return (size_t)(unsigned)mallinfo().uordblks;
+#endif
+}
+#define HEAP_USED() size32(host_heap_used())
+#else
+// umm's own count, kept by its stats (UMM_STATS, on in the core) and read
+// from DRAM. Not system_get_free_heap_size(), an SDK call that may be in
+// flash, and count_after() runs from free() in ISRs.
+#define HEAP_USED() (UMM_MALLOC_CFG_HEAP_SIZE - umm_free_heap_size_lw())
+#endif
+
+// After the real call, so in use is as it left the heap.
+static void IRAM_OPTION count_after(uint32_t *calls, uint32_t size, bool failed) {
+    EVLOG_INTR_LOCK();
+    (*calls)++;
+    if (failed)
+        heap_stats.failed++;
+    if (calls != &heap_stats.frees)
+        heap_stats.hist[size_class(size)]++;
+    uint32_t in_use = (uint32_t)HEAP_USED();
+    heap_stats.in_use = in_use;
+    if (in_use > heap_stats.peak)
+        heap_stats.peak = in_use;
+    EVLOG_INTR_UNLOCK();
+}
+
+static inline __attribute__((__always_inline__))
+uint32_t IRAM_OPTION caller_of(void *caller) {
+    return (uint32_t)((uintptr_t)caller - evlog_image_base());
+}
+
+void * IRAM_OPTION __wrap_malloc(size_t size) {
+    void *ptr = __real_malloc(size);
+    uint32_t flags = trace_flags;
+    if (0U == flags)
+        return ptr;
+
+    if (flags & EVLOG_HEAP_COUNTERS)
+        count_after(&heap_stats.allocs, size32(size), (NULL == ptr && 0U != size));
+    if (flags & EVLOG_HEAP_RECORDS)
+        EVLOG4_P(alloc_fmt(), (uint32_t)(uintptr_t)ptr, size32(size), caller_of(__builtin_return_address(0)));
+    return ptr;
+}
+
+void * IRAM_OPTION __wrap_calloc(size_t count, size_t size) {
+    void *ptr = __real_calloc(count, size);
+    uint32_t flags = trace_flags;
+    if (0U == flags)
+        return ptr;
+
+    uint32_t bytes = calloc_size(count, size);
+    if (flags & EVLOG_HEAP_COUNTERS)
+        count_after(&heap_stats.allocs, bytes, (NULL == ptr && 0U != bytes));
+    if (flags & EVLOG_HEAP_RECORDS)
+        EVLOG4_P(alloc_fmt(), (uint32_t)(uintptr_t)ptr, bytes, caller_of(__builtin_return_address(0)));
+    return ptr;
+}
+
+/*
+  realloc(NULL, n) is a malloc() and realloc(p, 0) may be a free(), both are
+  still logged as a realloc. A failed realloc() leaves `old` allocated.
+*/
+void * IRAM_OPTION __wrap_realloc(void *old, size_t size) {
+    uint32_t flags = trace_flags;
+    if (0U == flags)
+        return __real_realloc(old, size);
+
+    void *ptr = __real_realloc(old, size);
+    if (flags & EVLOG_HEAP_COUNTERS)
+        count_after(&heap_stats.reallocs, size32(size), (NULL == ptr && 0U != size));
+    if (flags & EVLOG_HEAP_RECORDS)
+        EVLOG5_P(realloc_fmt(), (uint32_t)(uintptr_t)old, (uint32_t)(uintptr_t)ptr, size32(size), caller_of(__builtin_return_address(0)));
+    return ptr;
+}
+
+void IRAM_OPTION __wrap_free(void *ptr) {
+    uint32_t flags = trace_flags;
+    if (0U == flags || NULL == ptr) {
+        __real_free(ptr);
+        return;
+    }
+
+    __real_free(ptr);
+    if (flags & EVLOG_HEAP_COUNTERS)
+        count_after(&heap_stats.frees, 0U, false);
+    if (flags & EVLOG_HEAP_RECORDS)
+        EVLOG3_P(free_fmt(), (uint32_t)(uintptr_t)ptr, caller_of(__builtin_return_address(0)));
+}
+
+/*
+  Set EVLOG_HEAP_COUNTERS and/or EVLOG_HEAP_RECORDS, 0 for off. Returns the
+  previous flags.
+*/
+uint32_t evlog_heap_trace(uint32_t flags) {
+    uint32_t was = trace_flags;
+    trace_flags = flags;
+    return was;
+}
+
+void evlog_heap_stats_clear(void) {
+    EVLOG_INTR_LOCK();
+    memset(&heap_stats, 0, sizeof(heap_stats));
+    heap_stats.in_use = (uint32_t)HEAP_USED();
+    heap_stats.peak = heap_stats.in_use;
+    EVLOG_INTR_UNLOCK();
+}
+
+void evlog_heap_get_stats(evlog_heap_stats_t *stats) {
+    EVLOG_INTR_LOCK();
+    *stats = heap_stats;
+    EVLOG_INTR_UNLOCK();
+}
+
+};
+
+void evlogPrintHeap(Print& out) {
+  evlog_heap_stats_t s;
+  evlog_heap_get_stats(&s);
+  out.printf_P(PSTR("EvLog Heap, tracing 0x%02X\r\n"), trace_flags);
+  out.printf_P(PSTR("  in use %u, peak %u bytes\r\n"), s.in_use, s.peak);
+  out.printf_P(PSTR("  allocs %u, reallocs %u, frees %u, failed %u\r\n"), s.allocs, s.reallocs, s.frees, s.failed);
+  out.print(F("  log2 request sizes:"));
+  for (uint32_t bin = 0; bin < EVLOG_HEAP_CLASSES; bin++) {
+    if (0U == s.hist[bin])
+      continue;
+    uint32_t lo = (0U == bin) ? 0U : 1U << (bin - 1U);
+    if (EVLOG_HEAP_CLASSES - 1U == bin)
+      out.printf_P(PSTR(" [%u+] %u"), lo, s.hist[bin]);
+    else
+      out.printf_P(PSTR(" [%u] %u"), lo, s.hist[bin]);
+  }
+  out.println();
+}
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_HEAP_H
@@ -0,0 +1,98 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Heap tracing. malloc(), calloc(), realloc() and free() are hooked with the
+  linker's --wrap, add to the build:
+
+    -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+
+  Without those options the hooks are never called and cost nothing.
+
+  evlog_heap_trace(flags) turns on
+    * EVLOG_HEAP_COUNTERS, live counters: bytes in use and its peak, call
+      counts, and a log2 histogram of request sizes. Cheap enough to leave
+      on in a production build.
+    * EVLOG_HEAP_RECORDS, a log entry for each call, holding the pointer,
+      size and caller, for host/evlog_heap to rebuild the heap over time and
+      find leaks and fragmentation from a dump.
+
+  Bytes in use are as the allocator sees them, every live block, those
+  from before tracing started too. On the ESP8266 it is the heap size less
+  umm_free_heap_size_lw(), on the host glibc's mallinfo2() uordblks.
+  Pointers are logged as 32 bits and callers relative to
+  evlog_image_base(). A failed call logs a NULL pointer.
+
+  Records need EVLOG_TOTAL_ARGS of 5.
+*/
+#include <evlog/src/event_logger.h>
+
+#if !defined(EVLOG_HEAP_H) && defined(EVLOG_ENABLE) && (EVLOG_TOTAL_ARGS > 4)
+#define EVLOG_HEAP_H
+
+#ifndef EVLOG_HEAP_CLASSES
+#define EVLOG_HEAP_CLASSES (16U)    // log2 size classes, the last is open ended
+#endif
+
+#define EVLOG_HEAP_COUNTERS (1U)
+#define EVLOG_HEAP_RECORDS  (2U)
+
+// The host tool finds heap records by these format strings.
+#define EVLOG_HEAP_ALLOC_FMT   "EvHeap+ 0x%08X %u, caller 0x%08X"
+#define EVLOG_HEAP_FREE_FMT    "EvHeap- 0x%08X, caller 0x%08X"
+#define EVLOG_HEAP_REALLOC_FMT "EvHeap~ 0x%08X to 0x%08X %u, caller 0x%08X"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _EVLOG_HEAP_STATS {
+    uint32_t in_use;        // Bytes
+    uint32_t peak;          // Highest in_use
+    uint32_t allocs;        // malloc() and calloc()
+    uint32_t reallocs;
+    uint32_t frees;         // Not counting free(NULL)
+    uint32_t failed;
+    uint32_t hist[EVLOG_HEAP_CLASSES];  // Requests by size, [0], [1], [2-3], [4-7], ...
+} evlog_heap_stats_t;
+
+uint32_t evlog_heap_trace(uint32_t flags);
+void evlog_heap_stats_clear(void);
+void evlog_heap_get_stats(evlog_heap_stats_t *stats);
+
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+void __wrap_free(void *ptr);
+
+#ifdef __cplusplus
+};
+#endif
+
+#ifdef Print_h
+void evlogPrintHeap(Print& out);
+#endif
+
+#elif !defined(EVLOG_HEAP_H)
+#define EVLOG_HEAP_H
+#define evlog_heap_trace(flags) (0U)
+#define evlog_heap_stats_clear() do{}while(false)
+#ifdef Print_h
+inline __attribute__((__always_inline__))
+void evlogPrintHeap(Print& out) {
+  (void)out;
+}
+#endif
+#endif
@@ -0,0 +1,178 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Host (Linux) platform layer for EvLog. See evlog_host.h.
+*/
+#ifdef EVLOG_HOST
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <evlog/src/evlog_host.h>
+#ifdef EVLOG_ENABLE
+#include <evlog/src/event_logger.h>
+#endif
+
+extern "C" {
+
+/*
+  Stands in for the block of DRAM taken away from the heap on the ESP8266.
+  Both are in .noinit, like the device memory they stand for, which the SDK
+  does not clear with .bss.
+*/
+uint32_t evlog_host_reserve[(EVLOG_HOST_RESERVE_SIZE + sizeof(uint32_t) - 1U) / sizeof(uint32_t)] __attribute__((aligned(16), section(".noinit")));
+uint32_t evlog_host_rtc[(512U - 128U) / sizeof(uint32_t)] __attribute__((section(".noinit")));   // User RTC memory past eboot
+
+extern const char __executable_start[];
+
+const evlog_host_file_t *evlog_host_map_file(const char *path, bool writer) {
+    static_assert(sizeof(evlog_host_file_t) <= EVLOG_HOST_FILE_HDR_SZ, "evlog_host_file_t grew past EVLOG_HOST_FILE_HDR_SZ");
+    const size_t file_size = EVLOG_HOST_FILE_HDR_SZ + EVLOG_HOST_RESERVE_SIZE;
+#ifdef EVLOG_ENABLE
+    const uint32_t entry_size = sizeof(evlog_entry_t);
+#else
+    const uint32_t entry_size = 0U;
+#endif
+
+    int fd = open(path, (writer) ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (0 > fd)
+        return NULL;
+
+    struct stat st;
+    if (0 != fstat(fd, &st) ||
+        (writer && (size_t)st.st_size != file_size && 0 != ftruncate(fd, (off_t)file_size)) ||
+        (!writer && (size_t)st.st_size != file_size)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, file_size, (writer) ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base)
+        return NULL;
+
+    evlog_host_file_t *hdr = (evlog_host_file_t *)base;
+    bool match = EVLOG_HOST_FILE_MAGIC == hdr->magic &&
+                 EVLOG_HOST_RESERVE_SIZE == hdr->reserve_size &&
+                 entry_size == hdr->entry_size;
+    if (writer) {
+        if (!match) {
+            // New or different layout. A zero cookie makes evlog_init() start over.
+            memset(base, 0, file_size);
+            hdr->magic = EVLOG_HOST_FILE_MAGIC;
+            hdr->reserve_size = EVLOG_HOST_RESERVE_SIZE;
+            hdr->entry_size = entry_size;
+        }
+        hdr->pid = (uint32_t)getpid();
+        hdr->image_base = (uint64_t)(uintptr_t)&__executable_start[0];
+    } else if (!match) {
+        munmap(base, file_size);
+        return NULL;
+    }
+
+#ifdef EVLOG_ENABLE
+    evlog_set_storage(EVLOG_STORAGE_USER, (char *)base + EVLOG_HOST_FILE_HDR_SZ, EVLOG_HOST_RESERVE_SIZE);
+#endif
+    return hdr;
+}
+
+static uint64_t host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+static const uint64_t boot_ns = host_ns();
+
+uint32_t micros(void) {
+    return (uint32_t)((host_ns() - boot_ns) / 1000U);
+}
+
+uint32_t millis(void) {
+    return (uint32_t)((host_ns() - boot_ns) / 1000000U);
+}
+
+/*
+  With rdtsc, the cycle count rate is the TSC rate, which we measure once
+  against CLOCK_MONOTONIC.
+*/
+uint32_t evlog_host_cycles_per_us(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    static uint32_t cycles_per_us = 0;
+    if (0 == cycles_per_us) {
+        uint64_t ns0 = host_ns();
+        uint64_t tsc0 = __builtin_ia32_rdtsc();
+        struct timespec delay = { 0, 20000000 };
+        nanosleep(&delay, NULL);
+        uint64_t tsc1 = __builtin_ia32_rdtsc();
+        uint64_t ns1 = host_ns();
+        cycles_per_us = (uint32_t)(((tsc1 - tsc0) * 1000U + (ns1 - ns0) / 2U) / (ns1 - ns0));
+        if (0 == cycles_per_us)
+            cycles_per_us = 1;
+    }
+    return cycles_per_us;
+#else
+    return EVLOG_HOST_CPU_MHZ;
+#endif
+}
+
+};
+
+size_t Print::vprintf(const char *fmt, va_list ap) {
+    char buf[256];
+    va_list ap2;
+    va_copy(ap2, ap);
+    int len = vsnprintf(buf, sizeof(buf), fmt, ap2);
+    va_end(ap2);
+    if (len < 0)
+        return 0;
+
+    if ((size_t)len < sizeof(buf))
+        return write((const uint8_t *)buf, (size_t)len);
+
+    std::string big((size_t)len + 1U, '\0');
+    vsnprintf(&big[0], big.size(), fmt, ap);
+    return write((const uint8_t *)big.data(), (size_t)len);
+}
+
+size_t Print::printf(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    size_t n = vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+size_t Print::printf_P(PGM_P fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    size_t n = vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+size_t HostFilePrint::write(uint8_t c) {
+    return (EOF == fputc(c, fp)) ? 0 : 1;
+}
+
+size_t HostFilePrint::write(const uint8_t *buf, size_t size) {
+    return fwrite(buf, 1, size, fp);
+}
+
+HostFilePrint Serial(stdout);
+
+#endif // EVLOG_HOST
@@ -0,0 +1,218 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Host (Linux) platform layer for EvLog.
+
+    Just enough of the Arduino ESP8266 Core is stood in here to build
+    event_logger.cpp natively, so we can measure and exercise EvLog off-device.
+    Build with `-DEVLOG_HOST`. On the ESP8266 this header is never included.
+
+      * `umm_static_reserve_addr` is a static array in evlog_host.cpp.
+        Its size can be set with `-DEVLOG_HOST_RESERVE_SIZE=<bytes>`.
+        evlog_host_map_file() moves the log into a file backed shared mapping,
+        so it outlives a crashed process, like DRAM outlives a reboot.
+      * User RTC memory is a static array as well.
+      * `esp_get_cycle_count()` uses rdtsc on x86, elsewhere it scales
+        `clock_gettime(CLOCK_MONOTONIC)` to an `EVLOG_HOST_CPU_MHZ` clock.
+      * `micros()` and `millis()` count from process start, like "since boot".
+      * `Print` writes through a virtual `write()`. `HostFilePrint` writes to a
+        FILE, `Serial` is one on stdout.
+*/
+#ifndef EVLOG_HOST_H
+#define EVLOG_HOST_H
+
+#ifdef EVLOG_HOST
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef EVLOG_HOST_RESERVE_SIZE
+#define EVLOG_HOST_RESERVE_SIZE (4096U)
+#endif
+
+// Only used when rdtsc is not available.
+#ifndef EVLOG_HOST_CPU_MHZ
+#define EVLOG_HOST_CPU_MHZ (80U)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint32_t evlog_host_reserve[];
+extern uint32_t evlog_host_rtc[];
+
+#define umm_static_reserve_addr ((void *)&evlog_host_reserve[0])
+#define umm_static_reserve_size ((size_t)EVLOG_HOST_RESERVE_SIZE)
+#define EVLOG_RTC_ADDR ((void *)&evlog_host_rtc[0])
+
+/*
+  A file mapped log starts with this header. The reserve, holding evlog_t,
+  follows at EVLOG_HOST_FILE_HDR_SZ.
+*/
+#define EVLOG_HOST_FILE_MAGIC (0x46764C45U)
+#define EVLOG_HOST_FILE_HDR_SZ (64U)
+
+typedef struct _EVLOG_HOST_FILE {
+    uint32_t magic;
+    uint32_t reserve_size;      // EVLOG_HOST_RESERVE_SIZE of the writer
+    uint32_t entry_size;        // sizeof(evlog_entry_t) of the writer
+    uint32_t pid;               // Last writer
+    uint64_t image_base;        // Writer's __executable_start, for resolving fmt pointers
+} evlog_host_file_t;
+
+/*
+  Place the log in a shared mapping of `path`, as EVLOG_STORAGE_USER. A
+  writer creates or resumes the file and should call this before
+  evlog_preinit(). A reader maps it read-only and sees the writer's events
+  live. Returns a pointer to the file header or NULL on error.
+*/
+const evlog_host_file_t *evlog_host_map_file(const char *path, bool writer);
+
+#ifndef ICACHE_RAM_ATTR
+#define ICACHE_RAM_ATTR
+#endif
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+#define ets_memset memset
+#define ets_memcpy memcpy
+
+#define PGM_P const char *
+// Aligned like the ESP8266 PSTR(), so format IDs (evlog_fmt_id()) work alike.
+#define PSTR(s) (__extension__({static const char __pstr__[] __attribute__((aligned(4))) = (s); &__pstr__[0];}))
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define strncpy_P strncpy
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+uint32_t evlog_host_cycles_per_us(void);
+uint32_t micros(void);
+uint32_t millis(void);
+
+#if defined(__x86_64__) || defined(__i386__)
+inline __attribute__((__always_inline__))
+uint32_t esp_get_cycle_count(void) {
+    return (uint32_t)__builtin_ia32_rdtsc();
+}
+#else
+inline __attribute__((__always_inline__))
+uint32_t esp_get_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+    return (uint32_t)(ns * EVLOG_HOST_CPU_MHZ / 1000U);
+}
+#endif
+
+#define clockCyclesPerMicrosecond() evlog_host_cycles_per_us()
+
+#ifdef __cplusplus
+};
+#endif
+
+#ifdef __cplusplus
+#include <string>
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+
+/*
+  Only the bits of String used by EvLog reports.
+*/
+class String {
+public:
+    String(const char *s = "") : str(s ? s : "") {}
+    String(const __FlashStringHelper *s) : String(reinterpret_cast<const char *>(s)) {}
+    String(char c) : str(1, c) {}
+    String(int v) : str(std::to_string(v)) {}
+    String(unsigned v) : str(std::to_string(v)) {}
+    String(long v) : str(std::to_string(v)) {}
+    String(unsigned long v) : str(std::to_string(v)) {}
+    String(unsigned v, unsigned char base) : str(to_base(v, base)) {}
+    const char *c_str() const { return str.c_str(); }
+    size_t length() const { return str.length(); }
+    String& operator +=(const String& rhs) { str += rhs.str; return *this; }
+    friend String operator +(String lhs, const String& rhs) { lhs += rhs; return lhs; }
+
+private:
+    static std::string to_base(unsigned v, unsigned char base) {
+        std::string s;
+        do {
+            s.insert(s.begin(), "0123456789abcdef"[v % base]);
+            v /= base;
+        } while (v);
+        return s;
+    }
+    std::string str;
+};
+#define HEX 16
+#define DEC 10
+
+#define Print_h
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size) {
+        size_t n = 0;
+        while (size--)
+            n += write(*buf++);
+        return n;
+    }
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned long v, int base = DEC) { return print(String((unsigned)v, base)); }
+
+    size_t println(void) { return write("\r\n"); }
+    template<typename T>
+    size_t println(const T& v) { size_t n = print(v); return n + println(); }
+
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    size_t printf_P(PGM_P fmt, ...) __attribute__((format(printf, 2, 3)));
+    size_t vprintf(const char *fmt, va_list ap);
+};
+
+#include <stdio.h>
+class HostFilePrint : public Print {
+public:
+    explicit HostFilePrint(FILE *f) : fp(f) {}
+    using Print::write;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+
+private:
+    FILE *fp;
+};
+
+extern HostFilePrint Serial;
+#endif // __cplusplus
+
+#endif // EVLOG_HOST
+#endif // EVLOG_HOST_H
@@ -0,0 +1,845 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  EventLog<Storage, Policy, Timestamp, Args>, the event log as a class
+  template. The evlog_*() C API and the EVLOG macros are a wrapper over one
+  default instance, EvlogDefault, configured by the EVLOG_* defines. More
+  logs can run beside it, each with its own layout and a store path inlined
+  at the call:
+
+    // A small crash log that survives a reboot. Shrink the default log, in
+    // the DRAM reserve, to make room for it first.
+    EVLOG_CONSTINIT EventLog<EvlogDram, EvlogLinear, EvlogTsCycles, 3> crash_log;
+    // A large WiFi trace, lost at reboot.
+    EVLOG_CONSTINIT EventLog<EvlogHeap, EvlogCircular, EvlogTsMicros, 5> wifi_trace;
+
+    evlog_set_storage(EVLOG_STORAGE_DRAM, NULL, 2048);
+    crash_log.preinit_at(EVLOG_NOZERO_COOKIE | 1, (char *)umm_static_reserve_addr + 2048, 1024);
+    wifi_trace.init_at(NULL, 16 * 1024);
+    ...
+    wifi_trace.log(PSTR("RSSI %d, channel %u"), rssi, channel);
+
+  Storage is where the log may be placed, EvlogDram, EvlogRtc, EvlogHeap,
+  EvlogUser, or EvlogAnyStorage to choose at run time as
+  evlog_set_storage() does. Until placed, a log is empty and drops events.
+  Policy is EvlogLinear, stop when full, or EvlogCircular. Timestamp is
+  EvlogTsCycles, EvlogTsMicros, EvlogTsMillis or EvlogTsNone. Args counts
+  the fmt and data words, 1 to 5, as EVLOG_TOTAL_ARGS.
+
+  The memory layout is that of the default log, the cookie at the start
+  identifies placement and layout. The host tools and the other EvLog
+  modules only see the default log.
+*/
+#include <evlog/src/event_logger.h>
+
+#if !defined(EVLOG_INSTANCE_H) && defined(EVLOG_ENABLE) && defined(__cplusplus)
+#define EVLOG_INSTANCE_H
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef Print_h
+#include <evlog/src/evlog_print.h>
+#endif
+
+extern "C" {
+/*
+  The words ahead of the events. cookie must be 1st and num 2nd, see
+  EventLog::clear(). The drop counts are here, not in the EventLog, so a
+  log resumed over a reset keeps them with its events.
+*/
+typedef struct _EVLOG_HEADER {
+    uintptr_t cookie;
+    uint32_t num;
+    uint32_t state;
+    uint32_t wrapped; // A word, RTC memory only takes 32-bit writes
+#ifdef EVLOG_SALVAGE
+    uint32_t seq;     // Of the last entry stored
+#endif
+    evlog_drops_t drops;
+} evlog_header_t;
+
+uintptr_t evlog_storage_area(evlog_storage_t storage, void *base, size_t *size);
+uintptr_t evlog_static_area(evlog_storage_t storage, void *base, size_t *size);
+extern evlog_header_t evlog_unplaced;
+const char *evlog_torn_fmt(void);
+};
+
+/*
+  A global EventLog must be constant initialized. It can be used before the
+  C++ constructors run, by evlog_preinit() from app_entry_redefinable() or
+  preinit(), and a constructor would then undo that work. With
+  EVLOG_CONSTINIT a log that would need a constructor fails to build.
+*/
+#if defined(__cpp_constinit)
+#define EVLOG_CONSTINIT constinit
+#define EVLOG_HAS_CONSTINIT 1
+#elif defined(__GNUC__) && (__GNUC__ >= 10)
+#define EVLOG_CONSTINIT __constinit
+#define EVLOG_HAS_CONSTINIT 1
+#else
+#define EVLOG_CONSTINIT
+#define EVLOG_HAS_CONSTINIT 0
+#endif
+
+/*
+  Storage policies.
+*/
+template <evlog_storage_t Kind>
+struct EvlogStorage {
+    static constexpr bool any = false;
+    static constexpr evlog_storage_t kind = Kind;
+};
+typedef EvlogStorage<EVLOG_STORAGE_DRAM> EvlogDram;
+typedef EvlogStorage<EVLOG_STORAGE_RTC> EvlogRtc;
+typedef EvlogStorage<EVLOG_STORAGE_HEAP> EvlogHeap;
+typedef EvlogStorage<EVLOG_STORAGE_USER> EvlogUser;
+
+struct EvlogAnyStorage {
+    static constexpr bool any = true;
+    static constexpr evlog_storage_t kind = EVLOG_STORAGE_USER;
+};
+
+/*
+  Logging policies.
+*/
+struct EvlogLinear {
+    static constexpr bool circular = false;
+};
+
+struct EvlogCircular {
+    static constexpr bool circular = true;
+};
+
+/*
+  Timestamp sources, `hz` is 0 for none. The CPU clock may run at twice
+  `hz`, to_us() uses the actual clock.
+*/
+struct EvlogTsCycles {
+    static constexpr uint32_t hz = EVLOG_TIMESTAMP_CLOCKCYCLES;
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t now(void) { return esp_get_cycle_count(); }
+    static uint64_t to_us(uint64_t ticks) { return ticks / clockCyclesPerMicrosecond(); }
+};
+
+struct EvlogTsMicros {
+    static constexpr uint32_t hz = EVLOG_TIMESTAMP_MICROS;
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t now(void) { return micros(); }
+    static uint64_t to_us(uint64_t ticks) { return ticks; }
+};
+
+struct EvlogTsMillis {
+    static constexpr uint32_t hz = EVLOG_TIMESTAMP_MILLIS;
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t now(void) { return millis(); }
+    static uint64_t to_us(uint64_t ticks) { return ticks * 1000U; }
+};
+
+struct EvlogTsNone {
+    static constexpr uint32_t hz = 0U;
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t now(void) { return 0U; }
+    static uint64_t to_us(uint64_t ticks) { return ticks; }
+};
+
+/*
+  An entry of `Args` words plus a timestamp. The layout of the build's
+  EVLOG_TOTAL_ARGS and EVLOG_TIMESTAMP is evlog_entry_t itself.
+*/
+template <unsigned Args, bool HasTs>
+struct EvlogEntry {
+    const char *fmt;
+    uint32_t data[Args - 1U];
+    uint32_t ts;
+#ifdef EVLOG_SALVAGE
+    uint32_t check;
+#endif
+};
+
+template <unsigned Args>
+struct EvlogEntry<Args, false> {
+    const char *fmt;
+    uint32_t data[Args - 1U];
+#ifdef EVLOG_SALVAGE
+    uint32_t check;
+#endif
+};
+
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+#define EVLOG_HAS_TS true
+#else
+#define EVLOG_HAS_TS false
+#endif
+
+template <unsigned Args, bool HasTs>
+struct EvlogEntryType {
+    typedef EvlogEntry<Args, HasTs> type;
+};
+
+template <>
+struct EvlogEntryType<EVLOG_TOTAL_ARGS, EVLOG_HAS_TS> {
+    typedef evlog_entry_t type;
+};
+
+template <class Storage, class Policy, class Timestamp, unsigned Args>
+class EventLog {
+    static_assert(Args >= 1U && Args <= 5U, "Args is 1 to 5");
+    static_assert(0U != EVLOG_DROP_FMTS && 0U == (EVLOG_DROP_FMTS & (EVLOG_DROP_FMTS - 1U)), "EVLOG_DROP_FMTS is a power of 2");
+
+public:
+    typedef typename EvlogEntryType<Args, (0U != Timestamp::hz)>::type entry_type;
+
+    static constexpr uint32_t data_max = Args - 1U;
+    static constexpr uint32_t ts_hz = Timestamp::hz;
+    static constexpr bool circular = Policy::circular;
+
+    static constexpr inline __attribute__((__always_inline__, no_instrument_function))
+    size_t size_of(uint32_t max) {
+        return sizeof(evlog_header_t) + max * sizeof(entry_type);
+    }
+
+    static constexpr inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t events_fit(size_t size) {
+        return (size < sizeof(evlog_header_t)) ? 0U : (uint32_t)((size - sizeof(evlog_header_t)) / sizeof(entry_type));
+    }
+
+    /*
+      Where the log is and its layout. A log left by a build with a different
+      entry size, argument count, or number of events, does not match and is
+      cleared rather than misread. EVLOG_STORAGE_USER logs are identified by
+      layout alone, the caller owns their persistence.
+    */
+    static constexpr inline __attribute__((__always_inline__, no_instrument_function))
+    uintptr_t make_cookie(evlog_storage_t storage, uintptr_t base, uint32_t max) {
+        return ((((EVLOG_STORAGE_USER == storage) ? 0U : base) ^
+                 ((uintptr_t)max << 16 | sizeof(entry_type) << 8 | (uintptr_t)storage << 4 | Args)) << 1) | 1U;
+    }
+
+    // Not placed, see set_storage(). Constant initialized, no constructor runs.
+    constexpr EventLog()
+        : hdr(&evlog_unplaced), max(0U), cookie(1U), storage(Storage::kind), size(0U), deferred(false), generation(0U) {}
+
+    /*
+      The whole of EVLOG_STORAGE_DRAM or EVLOG_STORAGE_RTC, placed by the
+      first init(). The address and cookie are worked out there, from the
+      storage in use, not by a constructor that may run after an early
+      evlog_preinit(). Used for the default log. Other storage stays
+      unplaced until set_storage(), the first init() may be in an ISR.
+    */
+    constexpr explicit EventLog(evlog_storage_t where)
+        : hdr(&evlog_unplaced), max(0U), cookie(1U), storage(where), size(0U), deferred(true), generation(0U) {}
+
+    /*
+      Select where the log lives, as evlog_set_storage(). Nothing is written
+      to the new location, the next init() validates the cookie there.
+    */
+    bool set_storage(evlog_storage_t where, void *base, size_t bytes) {
+        if (!Storage::any && Storage::kind != where)
+            return false;
+
+        uintptr_t addr = evlog_storage_area(where, base, &bytes);
+        uint32_t fit = events_fit(bytes);
+        if (0 == addr || 0 != (addr & 3U) || 0 == fit) {
+            if (EVLOG_STORAGE_HEAP == where)
+                free((void *)addr);
+            return false;
+        }
+
+        void *old_heap = (EVLOG_STORAGE_HEAP == storage && 0U != max) ? hdr : NULL;
+        adopt(where, addr, fit, bytes);
+        if (old_heap)
+            free(old_heap);
+
+        return true;
+    }
+
+    bool place(void *base, size_t bytes) {
+        return set_storage(Storage::kind, base, bytes);
+    }
+
+    evlog_storage_t get_storage(void **base, size_t *bytes) const {
+        if (base)
+            *base = (0U == max) ? NULL : hdr;
+        if (bytes)
+            *bytes = size;
+        return storage;
+    }
+
+    inline __attribute__((__always_inline__, no_instrument_function))
+    bool is_inited(void) const {
+        return (cookie == hdr->cookie);
+    }
+
+    inline __attribute__((__always_inline__, no_instrument_function))
+    void clear(void) {
+        if (0U == max)
+            return;
+        generation++;
+        // cookie is kept
+        uint32_t *p = (uint32_t *)&hdr->num;
+        size_t words = (size_of(max) - sizeof(hdr->cookie)) / sizeof(uint32_t);
+        if (words_only()) {
+            for (size_t i = 0; i < words; i++)
+                p[i] = 0;
+        } else {
+            ets_memset(p, 0, words * sizeof(uint32_t));
+        }
+    }
+
+    inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t get_state(void) const {
+        return (is_inited()) ? hdr->state : 0U;
+    }
+
+    uint32_t set_state(uint32_t state) {
+        uint32_t previous = get_state();
+        if (0U != max)
+            hdr->state = state;
+        return previous;
+    }
+
+    inline __attribute__((__always_inline__, no_instrument_function))
+    bool is_enable(void) const {
+        return 0U != (get_state() & EVLOG_ENABLE_MASK);
+    }
+
+    uint32_t stop(void) {
+        return set_state(get_state() & ~EVLOG_ENABLE_MASK);
+    }
+
+    uint32_t start(void) {
+        return set_state(get_state() | 1U);
+    }
+
+    /*
+      Clear and enable the log when the cookie does not match, it was just
+      powered on or placed. Returns where the log is.
+    */
+    inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t init(void) {
+        if (!is_inited())
+            init_log();
+        return (uint32_t)(uintptr_t)hdr;
+    }
+
+    uint32_t init_at(void *base, size_t bytes) {
+        place(base, bytes);
+        return init();
+    }
+
+    /*
+      Marks the start of a new boot, see evlog_preinit(). With
+      EVLOG_NOZERO_COOKIE in the state the log carries on, `new_state` is
+      ignored. With EVLOG_SALVAGE, num and wrapped are first rebuilt from
+      the entries, see salvage().
+    */
+    void preinit(uint32_t new_state) {
+        uint32_t dirty_value = init();
+        if (0U == max)
+            return;
+
+        if ((hdr->state & EVLOG_COOKIE_MASK) == EVLOG_NOZERO_COOKIE) {
+            uint32_t torn = ~0U;
+#ifdef EVLOG_SALVAGE
+            // 16-bit sequence numbers, a bigger log is only clamped.
+            if (max <= 0xFFFFU)
+                torn = salvage();
+#endif
+            // Should never occur, lets a broken log be read as full.
+            if (max < hdr->num)
+                hdr->num = max;
+            // As rebuilt, before the Resumed entry moves them on.
+            uint32_t num = hdr->num, wrapped = hdr->wrapped;
+            log(PSTR(">>> EvLog Resumed <<< state(0x%08X), cookie(0x%08X), p_evlog(0x%08X))"), hdr->state, (uint32_t)hdr->cookie, dirty_value);
+            if (~0U != torn)
+                log(PSTR(">>> EvLog Salvaged <<< num(%u), wrapped(%u), torn(%u)"), num, wrapped, torn);
+            return;
+        }
+        clear();
+        set_state(new_state);
+        log(PSTR(">>> EvLog Inited <<< state(0x%08X), cookie(0x%08X), p_evlog(0x%08X)"), hdr->state, (uint32_t)hdr->cookie, dirty_value);
+    }
+
+    void preinit_at(uint32_t new_state, void *base, size_t bytes) {
+        place(base, bytes);
+        preinit(new_state);
+    }
+
+    void restart(uint32_t state) {
+        uint32_t dirty_value = init();
+        if (0U == max)
+            return;
+
+        clear();
+        set_state(state);
+        log(PSTR(">>> EvLog Restarted <<< state(0x%08X), cookie(0x%08X), p_evlog(0x%08X)"), state, (uint32_t)hdr->cookie, dirty_value);
+    }
+
+    /*
+      Store an event. Data words past Args - 1 are dropped. Returns the slot
+      used plus one, 0 when the event was not stored.
+    */
+    inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t log(const char *fmt, uint32_t data0 = 0U, uint32_t data1 = 0U, uint32_t data2 = 0U, uint32_t data3 = 0U) {
+        // The first event after power on or placement goes the long way, so
+        // nothing is held across a call here.
+        if (!is_inited())
+            return log_init(fmt, data0, data1, data2, data3);
+        return store(fmt, data0, data1, data2, data3);
+    }
+
+    /*
+      Reading, oldest first with get_event(), or by slot.
+    */
+    uint32_t get_count(void) const {
+        if (!is_inited())
+            return 0U;
+        return (hdr->wrapped) ? max : hdr->num;
+    }
+
+    uint32_t get_max_events(void) const {
+        return max;
+    }
+
+    // The slot the last event went in plus one.
+    uint32_t get_num(bool *wrapped) const {
+        if (!is_inited()) {
+            if (wrapped)
+                *wrapped = false;
+            return 0U;
+        }
+        if (wrapped)
+            *wrapped = hdr->wrapped;
+        return hdr->num;
+    }
+
+    /*
+      Changes each time the log is cleared or placed, so a reader that keeps
+      state by slot knows to start over.
+    */
+    uint32_t get_generation(void) const {
+        return generation;
+    }
+
+    bool get_event_at(uint32_t slot, entry_type *entry) const {
+        if (!is_inited() || max <= slot)
+            return false;
+
+        *entry = events()[slot];
+        return true;
+    }
+
+    uint32_t get_start_index(void) const {
+        if (Policy::circular && is_inited() && hdr->wrapped)
+            return hdr->num;
+        return 0U;
+    }
+
+    /*
+      Returns false with the last entry, or when there is none.
+
+        for (bool more = true, first = true; more; first = false)
+            more = log.get_event(&e, first);
+    */
+    bool get_event(entry_type *entry, bool first) {
+        if (!is_inited())
+            return false;
+
+        if (first) {
+            iter.stop = hdr->num;
+            iter.next = get_start_index();
+        } else if (0 == iter.next) {
+            return false;
+        }
+
+        if (Policy::circular) {
+            if (max <= iter.next)
+                iter.next = 0;
+        } else if (max <= iter.next || 0 == iter.stop) {
+            return false;
+        }
+
+        if (entry)
+            *entry = events()[iter.next];
+
+        iter.next++;
+        if (iter.next == iter.stop) {
+            iter.next = 0;  // stop we are done
+            return false;
+        }
+        return true;
+    }
+
+    /*
+      Events dropped by a full linear log, or overwritten by a circular one,
+      since the log was last cleared. Kept with the log over a reset. Copied
+      by word, for RTC memory.
+    */
+    void get_drops(evlog_drops_t *out) const {
+        if (!is_inited()) {
+            *out = evlog_drops_t();
+            return;
+        }
+        const volatile uint32_t *from = (const volatile uint32_t *)&hdr->drops;
+        uint32_t *to = (uint32_t *)out;
+        for (size_t i = 0; i < sizeof(evlog_drops_t) / sizeof(uint32_t); i++)
+            to[i] = from[i];
+    }
+
+    void set_drops(const evlog_drops_t& saved) {
+        if (!is_inited())
+            return;
+        const uint32_t *from = (const uint32_t *)&saved;
+        volatile uint32_t *to = (volatile uint32_t *)&hdr->drops;
+        for (size_t i = 0; i < sizeof(evlog_drops_t) / sizeof(uint32_t); i++)
+            to[i] = from[i];
+    }
+
+    /*
+      Direct access for code that works on the log in place, e.g. rolling
+      back an entry.
+    */
+    evlog_header_t *header(void) const {
+        return hdr;
+    }
+
+    inline __attribute__((__always_inline__, no_instrument_function))
+    entry_type *events(void) const {
+        return reinterpret_cast<entry_type *>(hdr + 1);
+    }
+
+#ifdef Print_h
+    /*
+      A plain listing, time since boot in seconds and the formatted event.
+      Not the evlogPrintReport() of the default log, that knows about clock
+      records and its storage.
+    */
+    void print(Print& printer) {
+        char buf[EVLOG_REPORT_BUFFER];
+        EvlogBufferPrint out(printer, buf, sizeof(buf));
+        uint32_t count = 0;
+        for (bool more = true; more && count < max; count++) {
+            entry_type e = entry_type();
+            more = get_event(&e, (0 == count));
+            if (0 == count && !more)
+                break;
+
+            out.print(F("  "));
+            print_ts(out, e, HasTs<(0U != Timestamp::hz)>());
+            if (isPstrFmt(e.fmt)) {
+                uint32_t d[4] = {0U, 0U, 0U, 0U};
+                for (uint32_t i = 0; i < data_max; i++)
+                    d[i] = e.data[i];
+                out.printf_P(e.fmt, d[0], d[1], d[2], d[3]);
+            } else {
+                out.printf_P(PSTR("< ? >, 0x%08X"), (uint32_t)(uintptr_t)e.fmt);
+                for (uint32_t i = 0; i < data_max; i++)
+                    out.printf_P(PSTR(", 0x%08X"), e.data[i]);
+            }
+            out.print(F("\r\n"));
+        }
+        out.printf_P(PSTR("%u Logged Events of a possible %u.\r\n"), count, max);
+    }
+#endif
+
+private:
+    template <bool B> struct HasTs {};
+
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t stamp(entry_type *event, HasTs<true>) {
+        uint32_t ts = Timestamp::now();
+        event->ts = ts;
+        return ts;
+    }
+
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t stamp(entry_type *event, HasTs<false>) {
+        (void)event;
+        return 0U;
+    }
+
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t ts_of(const entry_type& e, HasTs<true>) {
+        return e.ts;
+    }
+
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t ts_of(const entry_type& e, HasTs<false>) {
+        (void)e;
+        return 0U;
+    }
+
+#ifdef Print_h
+    static void print_ts(EvlogBufferPrint& out, const entry_type& e, HasTs<true>) {
+        uint64_t us = Timestamp::to_us(e.ts);
+        out.printf_P(PSTR("%u.%06u: "), (uint32_t)(us / 1000000U), (uint32_t)(us % 1000000U));
+    }
+
+    static void print_ts(EvlogBufferPrint& out, const entry_type& e, HasTs<false>) {
+        (void)out;
+        (void)e;
+    }
+#endif
+
+    inline __attribute__((__always_inline__, no_instrument_function))
+    bool words_only(void) const {
+        return (Storage::any) ? EVLOG_STORAGE_RTC == storage : EVLOG_STORAGE_RTC == Storage::kind;
+    }
+
+    inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t store(const char *fmt, uint32_t data0, uint32_t data1, uint32_t data2, uint32_t data3) {
+        if (0U == (hdr->state & EVLOG_ENABLE_MASK)) {
+            // A linear log stops itself when full.
+            if (!Policy::circular && hdr->wrapped)
+                lost(fmt, &hdr->drops.dropped);
+            return 0U;
+        }
+
+        uint32_t num = hdr->num;
+        if (num >= max) {
+            if (!Policy::circular) {
+                hdr->state &= ~EVLOG_ENABLE_MASK;
+                hdr->wrapped = true;
+                lost(fmt, &hdr->drops.dropped);
+                return 0U;
+            }
+            num = 0;
+            hdr->wrapped = true;
+        }
+
+        entry_type *event = &events()[num];
+        if (Policy::circular && hdr->wrapped)
+            lost(event->fmt, &hdr->drops.overwritten);
+#ifdef EVLOG_SALVAGE
+        // Counted ahead of the entry, no whole entry is ever past hdr->seq.
+        uint32_t seq = hdr->seq + 1U;
+        hdr->seq = seq;
+#endif
+        event->fmt = fmt;
+        uint32_t *data = event->data;
+        if (data_max > 0U)
+            data[0] = data0;
+        if (data_max > 1U)
+            data[1] = data1;
+        if (data_max > 2U)
+            data[2] = data2;
+        if (data_max > 3U)
+            data[3] = data3;
+        uint32_t ts = stamp(event, HasTs<(0U != Timestamp::hz)>());
+#ifdef EVLOG_SALVAGE
+        event->check = make_check(seq, fmt, data0, data1, data2, data3, ts);
+#else
+        (void)ts;
+#endif
+        hdr->num = ++num;
+        return num;
+    }
+
+#ifdef EVLOG_SALVAGE
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t rotl5(uint32_t x) {
+        return x << 5 | x >> 27;
+    }
+
+    /*
+      The sequence number in the high half, a sum of it and the stored words
+      in the low. A cleared entry, all zero, does not check.
+    */
+    static inline __attribute__((__always_inline__, no_instrument_function))
+    uint32_t make_check(uint32_t seq, const char *fmt, uint32_t data0, uint32_t data1, uint32_t data2, uint32_t data3, uint32_t ts) {
+        uint32_t x = (uint32_t)(uintptr_t)fmt;
+        if (data_max > 0U)
+            x = rotl5(x) ^ data0;
+        if (data_max > 1U)
+            x = rotl5(x) ^ data1;
+        if (data_max > 2U)
+            x = rotl5(x) ^ data2;
+        if (data_max > 3U)
+            x = rotl5(x) ^ data3;
+        // The sequence number is summed too, so a flip in the high half shows.
+        x = rotl5(x) ^ ts ^ seq;
+        return seq << 16 | ((x ^ x >> 16 ^ 0xA55AU) & 0xFFFFU);
+    }
+
+    static uint32_t check_of(const entry_type& e, uint32_t seq) {
+        uint32_t d[4] = {0U, 0U, 0U, 0U};
+        for (uint32_t i = 0; i < data_max; i++)
+            d[i] = e.data[i];
+        return make_check(seq, e.fmt, d[0], d[1], d[2], d[3], ts_of(e, HasTs<(0U != Timestamp::hz)>()));
+    }
+
+    /*
+      Rebuild num and wrapped of a resumed log from its entries, one pass.
+      An entry is whole when it checks and its sequence number is less than
+      `max` behind hdr->seq. The newest whole entry is the last one logged.
+      Any other entry that is not cleared was torn by a reset in the middle
+      of its write, or is stale, and gets evlog_torn_fmt() as its fmt.
+      Returns the count of entries so marked.
+    */
+    uint32_t salvage(void) {
+        entry_type *event = events();
+        const char *torn_fmt = evlog_torn_fmt();
+        uint32_t top = hdr->seq;
+        uint32_t newest = max, newest_age = max, last_whole = 0U, torn = 0U;
+        for (uint32_t slot = 0; slot < max; slot++) {
+            const entry_type& e = event[slot];
+            uint32_t check = e.check;
+            uint32_t age = (top - (check >> 16)) & 0xFFFFU;
+            if (age < max && check == check_of(e, check >> 16)) {
+                if (age < newest_age) {
+                    newest_age = age;
+                    newest = slot;
+                }
+                last_whole = slot;
+                continue;
+            }
+            if ((0U != check || NULL != e.fmt) && torn_fmt != e.fmt) {
+                event[slot].fmt = torn_fmt;
+                torn++;
+            }
+        }
+
+        uint32_t num = (max == newest) ? 0U : newest + 1U;
+        bool wrapped = (max == num) && hdr->wrapped;
+        if (Policy::circular && max != newest && last_whole > newest)
+            wrapped = true;
+        hdr->num = num;
+        hdr->wrapped = wrapped;
+        if (max != newest)
+            hdr->seq = top - newest_age;
+        return torn;
+    }
+#endif
+
+    /*
+      Count an event lost, `fmt` is the one dropped or overwritten. A fmt
+      goes in one of two rows picked by its address, when both are taken by
+      others it counts as other.
+    */
+    inline __attribute__((__always_inline__, no_instrument_function))
+    void lost(const char *fmt, uint32_t *total) {
+        evlog_drops_t& drops = hdr->drops;
+        if (0U == drops.dropped && 0U == drops.overwritten)
+            drops.first_ts = Timestamp::now();
+        (*total)++;
+        uintptr_t i = ((uintptr_t)fmt >> 2) & (EVLOG_DROP_FMTS - 1U);
+        evlog_drop_fmt_t *row = &drops.fmt[i];
+        if (fmt != row->fmt && NULL != row->fmt)
+            row = &drops.fmt[i ^ ((EVLOG_DROP_FMTS > 1U) ? 1U : 0U)];
+        if (fmt == row->fmt) {
+            row->count++;
+        } else if (NULL == row->fmt) {
+            row->fmt = fmt;
+            row->count = 1U;
+        } else {
+            drops.other++;
+        }
+    }
+
+    uint32_t __attribute__((noinline, no_instrument_function)) ICACHE_RAM_ATTR
+    log_init(const char *fmt, uint32_t data0, uint32_t data1, uint32_t data2, uint32_t data3) {
+        init_log();
+        if (!is_inited())
+            return 0U;
+        return store(fmt, data0, data1, data2, data3);
+    }
+
+    // Locked, an ISR must not log to a half placed log.
+    inline __attribute__((__always_inline__, no_instrument_function))
+    void adopt(evlog_storage_t where, uintptr_t addr, uint32_t fit, size_t bytes) {
+        EVLOG_INTR_LOCK();
+        hdr = (evlog_header_t *)addr;
+        max = fit;
+        cookie = make_cookie(where, addr, fit);
+        storage = where;
+        size = bytes;
+        deferred = false;
+        generation++;
+        EVLOG_INTR_UNLOCK();
+    }
+
+    /*
+      The deferred placement, from the first init() or EVLOG*(). Only the
+      fixed DRAM and RTC areas, all in IRAM, no malloc(). A log for the heap
+      is placed by set_storage().
+    */
+    inline __attribute__((__always_inline__, no_instrument_function))
+    bool place_deferred(void) {
+        size_t bytes = 0U;
+        uintptr_t addr = evlog_static_area(storage, NULL, &bytes);
+        uint32_t fit = events_fit(bytes);
+        if (0 == addr || 0 != (addr & 3U) || 0 == fit)
+            return false;
+        adopt(storage, addr, fit, bytes);
+        return true;
+    }
+
+    // Out of line, the store path only tests the cookie.
+    void __attribute__((noinline)) ICACHE_RAM_ATTR init_log(void) {
+        if (0U == max) {
+            if (!deferred || !place_deferred())
+                return;
+            // A log kept over a reset.
+            if (is_inited())
+                return;
+        }
+
+        clear();
+        hdr->cookie = cookie;
+        // Make things just work. For now always enable an inited log.
+        // preinit() can change it from there.
+        hdr->state = 1U;
+    }
+
+    evlog_header_t *hdr;
+    uint32_t max;
+    uintptr_t cookie;
+    evlog_storage_t storage;
+    size_t size;
+    bool deferred;          // Placement waits for init()
+    uint32_t generation;    // Bumped by clear() and set_storage()
+    struct {
+        uint32_t next;
+        uint32_t stop;
+    } iter = {0, 0};
+};
+
+/*
+  The log behind the evlog_*() C API.
+*/
+#ifdef EVLOG_CIRCULAR
+typedef EvlogCircular EvlogDefaultPolicy;
+#else
+typedef EvlogLinear EvlogDefaultPolicy;
+#endif
+
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+typedef EvlogTsCycles EvlogDefaultTs;
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS)
+typedef EvlogTsMicros EvlogDefaultTs;
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+typedef EvlogTsMillis EvlogDefaultTs;
+#else
+typedef EvlogTsNone EvlogDefaultTs;
+#endif
+
+typedef EventLog<EvlogAnyStorage, EvlogDefaultPolicy, EvlogDefaultTs, EVLOG_TOTAL_ARGS> EvlogDefault;
+
+#elif !defined(EVLOG_INSTANCE_H)
+#define EVLOG_INSTANCE_H
+#endif
@@ -1,6 +1,8 @@
 /*
     This is based on core_esp8266core_esp8266_app_entry_noextra4k.cpp.
 
+    Build with -DENABLE_EVLOG_MAIN=1 to start the log, the flash counters and
+    the boot profile (evlog_boot.h) at app_entry, before the SDK runs.
 */
 /*
  *  This is the original app_entry() not providing extra 4K heap, but allowing
@@ -9,14 +11,32 @@
  *  see comments in core_esp8266_main.cpp's app_entry()
  *
  */
+#include <Arduino.h>
 #include <c_types.h>
 #include "cont.h"
 #include "coredecls.h"
 #include <spi_flash.h>
 #include <evlog/src/event_logger.h>
+#include <evlog/src/evlog_instance.h>
 #include <evlog/src/flash_stats.h>
+#include <evlog/src/evlog_boot.h>
+
+#ifndef ENABLE_EVLOG_MAIN
+#define ENABLE_EVLOG_MAIN 0
+#endif
+
+#if ENABLE_EVLOG_MAIN
+/*
+  app_entry_redefinable() runs before the SDK clears .bss and before the C++
+  constructors. The log is usable there because evlog_default is constant
+  initialized data, checked by EVLOG_CONSTINIT, and is placed and given its
+  cookie by the first evlog_preinit(). The boot history is in .noinit.
+  host/test/test_app_entry.cpp runs this sequence and then clears .bss.
+*/
+#if defined(EVLOG_ENABLE) && !EVLOG_HAS_CONSTINIT
+#error "ENABLE_EVLOG_MAIN needs constinit, GCC 10 or later, to check the log is set up before app_entry"
+#endif
 
-#if 0 //ENABLE_EVLOG_MAIN
 void enable_evlog_at_link_time(void)
 {
     /*
@@ -50,6 +70,7 @@ extern "C" void app_entry_redefinable(void)
 #if ENABLE_FLASH_STATS
     preinit_flash_stats();
 #endif
+    evlog_boot_begin();
 
 #ifdef EVLOG_NOEXTRA4K
     g_pcont = &g_cont;
@@ -66,7 +87,17 @@ extern "C" void app_entry_redefinable(void)
 
     /* Call the entry point of the SDK code. */
     EVLOG1("*** call_user_start() - NONOS SDK");
+    evlog_boot_mark(EVLOG_BOOT_SDK_START);
     call_user_start();
 }
 
+/*
+  The core's user_init() calls initVariant() after init() and before
+  preinit(). A board variant with its own initVariant() should mark
+  EVLOG_BOOT_USER_INIT there instead.
+*/
+void initVariant(void) {
+    evlog_boot_mark(EVLOG_BOOT_USER_INIT);
+}
+
 #endif
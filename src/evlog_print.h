@@ -0,0 +1,141 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  A Print that collects output in a caller supplied buffer and passes it on
+  in large writes, for the reports. Reports are often wanted right after a
+  crash, when the heap may be least healthy, so nothing here allocates.
+
+    char buf[EVLOG_REPORT_BUFFER];
+    EvlogBufferPrint report(Serial, buf, sizeof(buf));
+    report.printf_P(PSTR("%u events\r\n"), count);
+
+  printf_P() formats straight into the buffer. Print::printf_P() formats into
+  a small stack buffer and, on the ESP8266 Core, allocates for anything
+  longer. One printf_P() call longer than the buffer is cut short.
+
+  The rest is written by flush(), or when the object goes out of scope.
+*/
+#ifndef EVLOG_PRINT_H
+#define EVLOG_PRINT_H
+
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Print.h>
+#endif
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef EVLOG_REPORT_BUFFER
+#define EVLOG_REPORT_BUFFER (256U)  // Report line buffer, on the stack
+#endif
+
+#ifdef Print_h
+class EvlogBufferPrint : public Print {
+public:
+    EvlogBufferPrint(Print& out, char *buf, size_t size) : out(out), buf(buf), size(size) {}
+    ~EvlogBufferPrint() { flush(); }
+    EvlogBufferPrint(const EvlogBufferPrint&) = delete;
+    EvlogBufferPrint& operator=(const EvlogBufferPrint&) = delete;
+
+    using Print::write;
+    size_t write(uint8_t c) override {
+        if (len == size)
+            flush();
+        buf[len++] = (char)c;
+        return 1U;
+    }
+    size_t write(const uint8_t *data, size_t n) override {
+        if (len + n > size)
+            flush();
+        if (n > size)
+            return out.write(data, n);  // Too big to gather, pass it on
+        memcpy(&buf[len], data, n);
+        len += n;
+        return n;
+    }
+
+    size_t printf_P(PGM_P fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list ap;
+        va_start(ap, fmt);
+        size_t n = vprintf_P(fmt, ap);
+        va_end(ap);
+        return n;
+    }
+
+    size_t vprintf_P(PGM_P fmt, va_list ap) {
+        va_list ap2;
+        va_copy(ap2, ap);
+        int n = vsnprintf_P(&buf[len], size - len, fmt, ap2);
+        va_end(ap2);
+        if (0 > n)
+            return 0U;
+
+        if ((size_t)n >= size - len && 0U != len) {
+            flush();
+            n = vsnprintf_P(buf, size, fmt, ap);
+            if (0 > n)
+                return 0U;
+        }
+        // vsnprintf leaves room for a '\0' that is not output
+        if ((size_t)n >= size - len)
+            n = (int)(size - len - 1U);
+        len += (size_t)n;
+        return (size_t)n;
+    }
+
+    void flush() {
+        if (len)
+            out.write((const uint8_t *)buf, len);
+        len = 0U;
+    }
+
+private:
+    Print& out;
+    char *buf;
+    size_t size;
+    size_t len = 0U;
+};
+
+/*
+  Counts what reaches `out`, and whether all of it was taken. For writers
+  that report a short write, as evlogWriteCompressed() does.
+*/
+class EvlogCountPrint : public Print {
+public:
+    EvlogCountPrint(Print& out) : out(out) {}
+    using Print::write;
+    size_t write(uint8_t c) override {
+        size_t n = out.write(c);
+        count += n;
+        ok = ok && (1U == n);
+        return n;
+    }
+    size_t write(const uint8_t *buf, size_t size) override {
+        size_t n = out.write(buf, size);
+        count += n;
+        ok = ok && (size == n);
+        return n;
+    }
+
+    Print& out;
+    size_t count = 0;
+    bool ok = true;
+};
+#endif // Print_h
+
+#endif // EVLOG_PRINT_H
@@ -0,0 +1,115 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    The -finstrument-functions hooks, see evlog_profiler.h.
+
+    The hooks run for every instrumented call, so they are in IRAM and do
+    little more than an EVLOG3_P. A busy flag keeps an instrumented function
+    called from inside the logging path, or an interrupt landing there, from
+    recursing. Such a nested call is not logged.
+
+    Addresses are logged relative to evlog_image_base(), the same as fmt
+    pointers in a dump.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <evlog/src/evlog_profiler.h>
+
+#ifdef EVLOG_PROFILER_H
+#ifdef EVLOG_ENABLE
+
+extern "C" {
+#define IRAM_OPTION ICACHE_RAM_ATTR
+#define NO_INSTRUMENT __attribute__((no_instrument_function))
+
+static volatile bool profiler_on = false;
+static volatile bool profiler_busy = false;
+static uint32_t range_count = 0;
+static struct {
+    uintptr_t lo;
+    uintptr_t hi;
+} ranges[EVLOG_PROFILER_RANGES];
+
+/*
+  Returns the previous setting.
+*/
+bool NO_INSTRUMENT evlog_profiler_enable(bool enable) {
+    bool was = profiler_on;
+    profiler_on = enable;
+    return was;
+}
+
+/*
+  Only log functions with lo <= fn < hi. Returns false when the range table
+  is full.
+*/
+bool NO_INSTRUMENT evlog_profiler_add_range(const void *lo, const void *hi) {
+    if (EVLOG_PROFILER_RANGES <= range_count || (uintptr_t)lo >= (uintptr_t)hi)
+        return false;
+
+    bool was = evlog_profiler_enable(false);
+    ranges[range_count].lo = (uintptr_t)lo;
+    ranges[range_count].hi = (uintptr_t)hi;
+    range_count++;
+    evlog_profiler_enable(was);
+    return true;
+}
+
+void NO_INSTRUMENT evlog_profiler_clear_ranges(void) {
+    range_count = 0;
+}
+
+static inline __attribute__((__always_inline__))
+bool IRAM_OPTION NO_INSTRUMENT in_range(uintptr_t fn) {
+    if (0 == range_count)
+        return true;
+
+    for (uint32_t i = 0; i < range_count; i++) {
+        if (ranges[i].lo <= fn && fn < ranges[i].hi)
+            return true;
+    }
+    return false;
+}
+
+static inline __attribute__((__always_inline__))
+void IRAM_OPTION NO_INSTRUMENT profile_event(const char *fmt, void *fn, void *call_site) {
+    if (!profiler_on || profiler_busy || !in_range((uintptr_t)fn))
+        return;
+
+    profiler_busy = true;
+    uintptr_t base = evlog_image_base();
+    EVLOG3_P(fmt, (uint32_t)((uintptr_t)fn - base), (uint32_t)((uintptr_t)call_site - base));
+    profiler_busy = false;
+}
+
+void IRAM_OPTION __cyg_profile_func_enter(void *fn, void *call_site) {
+    profile_event(PSTR(EVLOG_PROFILER_ENTER_FMT), fn, call_site);
+}
+
+void IRAM_OPTION __cyg_profile_func_exit(void *fn, void *call_site) {
+    profile_event(PSTR(EVLOG_PROFILER_EXIT_FMT), fn, call_site);
+}
+
+};
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_PROFILER_H
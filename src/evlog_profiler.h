@@ -0,0 +1,63 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Function entry/exit profiling with GCC's -finstrument-functions.
+
+  Build the code to profile with -finstrument-functions, and EvLog itself
+  without it. Each instrumented call then adds two events to the log, an
+  "EvProf>" entry and an "EvProf<" exit, holding the function and call site
+  addresses. Write the log out with evlogWriteDump() and hand it, with the
+  .elf or executable, to host/evlog_profile for per function inclusive and
+  exclusive time and the call tree.
+
+  Profiling starts stopped. Limit it to address ranges, e.g. one library's
+  code, with evlog_profiler_add_range(). With no ranges every instrumented
+  function is logged.
+*/
+#if !defined(EVLOG_PROFILER_H) && defined(EVLOG_ENABLE)
+#define EVLOG_PROFILER_H
+
+#include <evlog/src/event_logger.h>
+
+#ifndef EVLOG_PROFILER_RANGES
+#define EVLOG_PROFILER_RANGES (4U)
+#endif
+
+// The host tool finds profiler events by these format strings.
+#define EVLOG_PROFILER_ENTER_FMT "EvProf> 0x%08X 0x%08X"
+#define EVLOG_PROFILER_EXIT_FMT  "EvProf< 0x%08X 0x%08X"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool evlog_profiler_enable(bool enable);
+bool evlog_profiler_add_range(const void *lo, const void *hi);
+void evlog_profiler_clear_ranges(void);
+
+void __cyg_profile_func_enter(void *fn, void *call_site) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void *fn, void *call_site) __attribute__((no_instrument_function));
+
+#ifdef __cplusplus
+};
+#endif
+
+#elif !defined(EVLOG_PROFILER_H)
+#define EVLOG_PROFILER_H
+#define evlog_profiler_enable(enable) (false)
+#define evlog_profiler_add_range(lo, hi) (false)
+#define evlog_profiler_clear_ranges() do{}while(false)
+#endif
@@ -0,0 +1,259 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Queries over the stored log, see evlog_query.h.
+
+    Entries are read by slot with evlog_get_event_at(), oldest first. The
+    log is not stopped, an event logged during a query may or may not be
+    seen.
+
+    The optional index is a small table of slot bitmaps, one per fmt, reused
+    least recently asked for first. It does not carry over a reboot.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <evlog/src/evlog_query.h>
+
+#ifdef EVLOG_QUERY_H
+#ifdef EVLOG_ENABLE
+
+extern "C" {
+
+void evlog_query_init(evlog_query_t *query) {
+    memset(query, 0, sizeof(*query));
+}
+
+/*
+  Match data word `i` where (data[i] & mask) == match, or != with invert.
+*/
+bool evlog_query_data(evlog_query_t *query, uint32_t i, uint32_t mask, uint32_t match, bool invert) {
+    if (EVLOG_DATA_MAX <= i)
+        return false;
+
+    query->mask[i] = mask;
+    query->match[i] = match & mask;
+    if (invert)
+        query->invert |= 1U << i;
+    else
+        query->invert &= ~(1U << i);
+    return true;
+}
+
+/*
+  Match timestamps from ts_from to ts_to, both included. Returns false, and
+  changes nothing, when the build has no timestamps.
+*/
+bool evlog_query_window(evlog_query_t *query, uint32_t ts_from, uint32_t ts_to) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    query->ts_from = ts_from;
+    query->ts_to = ts_to;
+    query->flags |= EVLOG_QUERY_F_TS;
+    return true;
+#else
+    (void)query;
+    (void)ts_from;
+    (void)ts_to;
+    return false;
+#endif
+}
+
+bool evlog_query_match(const evlog_query_t *query, const evlog_entry_t *entry) {
+    if (query->fmt && query->fmt != entry->fmt)
+        return false;
+
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    if ((query->flags & EVLOG_QUERY_F_TS) &&
+        (uint32_t)(entry->ts - query->ts_from) > (uint32_t)(query->ts_to - query->ts_from))
+        return false;
+#endif
+
+    for (size_t i = 0; i < EVLOG_DATA_MAX; i++) {
+        bool equal = ((entry->data[i] & query->mask[i]) == query->match[i]);
+        if (equal == (0U != (query->invert & (1U << i))))
+            return false;
+    }
+    return true;
+}
+
+/*
+  Slots in use, and the slot of the oldest event.
+*/
+static uint32_t log_extent(uint32_t *start, uint32_t *num, bool *wrapped) {
+    uint32_t max = evlog_get_max_events();
+    *num = evlog_get_num(wrapped);
+    *start = 0U;
+#ifdef EVLOG_CIRCULAR
+    if (*wrapped) {
+        *start = (*num < max) ? *num : 0U;
+        return max;
+    }
+#endif
+    return (*wrapped || *num > max) ? max : *num;
+}
+
+#if (EVLOG_QUERY_INDEX > 0)
+#define INDEX_WORDS ((EVLOG_QUERY_INDEX_SLOTS + 31U) / 32U)
+
+static struct {
+    const char *fmt;
+    uint32_t num;           // evlog_get_num() when last brought up to date
+    uint32_t generation;    // and evlog_get_generation()
+    bool wrapped;
+    uint32_t used;          // For least recently used
+    uint32_t bits[INDEX_WORDS];
+} fmt_index[EVLOG_QUERY_INDEX];
+static uint32_t index_clock = 0;
+
+void evlog_query_index_clear(void) {
+    memset(fmt_index, 0, sizeof(fmt_index));
+}
+
+static void index_scan(uint32_t n, uint32_t from, uint32_t to) {
+    const char *fmt = fmt_index[n].fmt;
+    for (uint32_t slot = from; slot < to; slot++) {
+        evlog_entry_t entry;
+        if (!evlog_get_event_at(slot, &entry))
+            break;
+        if (fmt == entry.fmt)
+            fmt_index[n].bits[slot / 32U] |= 1U << (slot % 32U);
+        else
+            fmt_index[n].bits[slot / 32U] &= ~(1U << (slot % 32U));
+    }
+}
+
+/*
+  The bitmap for `fmt`, brought up to date, or -1 when there is none.
+*/
+static int32_t index_for(const char *fmt) {
+    if (NULL == fmt || EVLOG_QUERY_INDEX_SLOTS < evlog_get_max_events())
+        return -1;
+
+    uint32_t start, num;
+    bool wrapped;
+    uint32_t count = log_extent(&start, &num, &wrapped);
+    uint32_t generation = evlog_get_generation();
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < EVLOG_QUERY_INDEX; i++) {
+        if (fmt == fmt_index[i].fmt) {
+            n = i;
+            break;
+        }
+        if (fmt_index[i].used < fmt_index[n].used)
+            n = i;
+    }
+    // A log cleared or placed since may have grown past the old num.
+    bool rebuild = (fmt != fmt_index[n].fmt || generation != fmt_index[n].generation);
+    fmt_index[n].fmt = fmt;
+    fmt_index[n].used = ++index_clock;
+
+    if (!rebuild && num == fmt_index[n].num && wrapped == fmt_index[n].wrapped)
+        return (int32_t)n;
+
+#ifdef EVLOG_CIRCULAR
+    // Once wrapped, new events overwrite slots all around the log.
+    rebuild = rebuild || wrapped;
+#endif
+    if (rebuild || num < fmt_index[n].num || (fmt_index[n].wrapped && !wrapped)) {
+        memset(fmt_index[n].bits, 0, sizeof(fmt_index[n].bits));
+        index_scan(n, 0U, count);
+    } else {
+        index_scan(n, fmt_index[n].num, count);
+    }
+    fmt_index[n].num = num;
+    fmt_index[n].generation = generation;
+    fmt_index[n].wrapped = wrapped;
+    return (int32_t)n;
+}
+#else
+void evlog_query_index_clear(void) {
+}
+
+static int32_t index_for(const char *fmt) {
+    (void)fmt;
+    return -1;
+}
+#endif
+
+bool evlog_query_next(evlog_query_iter_t *it, evlog_entry_t *entry) {
+    uint32_t max = evlog_get_max_events();
+    while (it->pos < it->count) {
+        uint32_t slot = it->start + it->pos;
+        if (slot >= max)
+            slot -= max;
+#if (EVLOG_QUERY_INDEX > 0)
+        if (0 <= it->index) {
+            // Skip to the next set bit, not past the end of the log.
+            uint32_t word = fmt_index[it->index].bits[slot / 32U] >> (slot % 32U);
+            uint32_t skip = (word) ? (uint32_t)__builtin_ctz(word) : 32U - slot % 32U;
+            if (skip > max - slot)
+                skip = max - slot;
+            if (skip) {
+                it->pos += skip;
+                continue;
+            }
+        }
+#endif
+        it->pos++;
+        if (evlog_get_event_at(slot, entry) && evlog_query_match(it->query, entry)) {
+            it->slot = slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool evlog_query_first(evlog_query_iter_t *it, const evlog_query_t *query, evlog_entry_t *entry) {
+    uint32_t num;
+    bool wrapped;
+    memset(it, 0, sizeof(*it));
+    it->query = query;
+    it->index = index_for(query->fmt);
+    it->count = log_extent(&it->start, &num, &wrapped);
+    return evlog_query_next(it, entry);
+}
+
+/*
+  Calls `cb` for each match, oldest first, until it returns false. Returns
+  the number of matches passed to `cb`.
+*/
+uint32_t evlog_query(const evlog_query_t *query, evlog_query_cb_t cb, void *arg) {
+    evlog_query_iter_t it;
+    evlog_entry_t entry;
+    uint32_t matches = 0;
+    for (bool ok = evlog_query_first(&it, query, &entry); ok; ok = evlog_query_next(&it, &entry)) {
+        matches++;
+        if (cb && !cb(&entry, it.slot, arg))
+            break;
+    }
+    return matches;
+}
+
+};
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_QUERY_H
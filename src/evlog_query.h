@@ -0,0 +1,101 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Find events in the stored log, on the device, oldest first.
+
+    evlog_query_t q;
+    evlog_query_init(&q);
+    q.fmt = flash_log.w_count.label;       // SPIWrite events
+    evlog_query_data(&q, 0, ~0U, 0U, true); // with data[0], err, not 0
+    evlog_query(&q, print_one, &server);
+
+  or, with an iterator:
+
+    evlog_query_iter_t it;
+    evlog_entry_t e;
+    for (bool ok = evlog_query_first(&it, &q, &e); ok; ok = evlog_query_next(&it, &e))
+      ...
+
+  A query matches on any of
+    * fmt, the PSTR() pointer. For an ID from evlog_fmt_id(), set
+      fmt = evlog_id_fmt(id).
+    * a timestamp window, ts_from to ts_to inclusive, wrap safe.
+    * per data word, (data[i] & mask[i]) == match[i], or != with `invert`.
+
+  With EVLOG_QUERY_INDEX > 0, queries by fmt keep a bitmap of the slots
+  holding that fmt, for the last EVLOG_QUERY_INDEX fmts asked for. A bitmap
+  is brought up to date at the next query, from the new slots of a linear
+  log, or by a rescan once a circular log has wrapped or the log was
+  cleared or placed, see evlog_get_generation(). Repeat queries then
+  skip straight to the matching slots. A log of more than
+  EVLOG_QUERY_INDEX_SLOTS events is scanned instead.
+*/
+#include <evlog/src/event_logger.h>
+
+#if !defined(EVLOG_QUERY_H) && defined(EVLOG_ENABLE)
+#define EVLOG_QUERY_H
+
+#ifndef EVLOG_QUERY_INDEX
+#define EVLOG_QUERY_INDEX (0U)          // fmts with a slot bitmap, 0 for none
+#endif
+#ifndef EVLOG_QUERY_INDEX_SLOTS
+#define EVLOG_QUERY_INDEX_SLOTS (1024U) // Bits per bitmap
+#endif
+
+#define EVLOG_QUERY_F_TS (1U)           // Use ts_from and ts_to
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _EVLOG_QUERY {
+    const char *fmt;                    // NULL for any
+    uint32_t flags;
+    uint32_t ts_from;
+    uint32_t ts_to;
+    uint32_t mask[EVLOG_DATA_MAX];
+    uint32_t match[EVLOG_DATA_MAX];
+    uint32_t invert;                    // Bit i, data[i] must not match
+} evlog_query_t;
+
+typedef struct _EVLOG_QUERY_ITER {
+    const evlog_query_t *query;
+    int32_t index;                      // Bitmap in use, -1 for a scan
+    uint32_t start;                     // Slot of the oldest event
+    uint32_t count;
+    uint32_t pos;                       // Next event, 0 is the oldest
+    uint32_t slot;                      // Of the entry last returned
+} evlog_query_iter_t;
+
+// Return false to stop.
+typedef bool (*evlog_query_cb_t)(const evlog_entry_t *entry, uint32_t slot, void *arg);
+
+void evlog_query_init(evlog_query_t *query);
+bool evlog_query_data(evlog_query_t *query, uint32_t i, uint32_t mask, uint32_t match, bool invert);
+bool evlog_query_window(evlog_query_t *query, uint32_t ts_from, uint32_t ts_to);
+bool evlog_query_match(const evlog_query_t *query, const evlog_entry_t *entry);
+uint32_t evlog_query(const evlog_query_t *query, evlog_query_cb_t cb, void *arg);
+bool evlog_query_first(evlog_query_iter_t *it, const evlog_query_t *query, evlog_entry_t *entry);
+bool evlog_query_next(evlog_query_iter_t *it, evlog_entry_t *entry);
+void evlog_query_index_clear(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#elif !defined(EVLOG_QUERY_H)
+#define EVLOG_QUERY_H
+#endif
@@ -0,0 +1,248 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Compact RTC memory event log, for events that must survive deep sleep.
+
+    RTC memory only takes 32-bit reads and writes. An entry is kept as two
+    words, (arg << 16 | id) and ts, and everything goes through volatile
+    uint32_t pointers.
+
+    Typical use:
+      preinit():  evlog_rtc_init();   // every boot and wake
+      ...
+      evlog_rtc_deep_sleep(60 * 1000000ULL, 32);  // last 32 DRAM log events
+
+    After the next wake, evlogPrintRtcReport(Serial) shows what came before.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#include <Esp.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <evlog/src/evlog_rtc.h>
+
+#ifdef EVLOG_RTC_H
+#ifdef EVLOG_ENABLE
+
+extern "C" {
+#define IRAM_OPTION ICACHE_RAM_ATTR
+
+typedef struct _EVLOG_RTC_STRUCT {
+    uint32_t cookie;
+    uint32_t num;         // Next slot
+    uint32_t wrapped;
+    uint32_t wakes;
+    uint32_t last_ts;     // For EVLOG_RTC_TS_DELTA
+    uint32_t event[][2];  // (arg << 16 | id), ts
+} evlog_rtc_t;
+
+#define EVLOG_RTC_MAX_EVENTS ((EVLOG_RTC_SZ - offsetof(evlog_rtc_t, event)) / (2U * sizeof(uint32_t)))
+
+static volatile evlog_rtc_t * const p_rtc = (volatile evlog_rtc_t *)EVLOG_RTC_ADDR;
+
+#ifdef EVLOG_RTC_TS_DELTA
+#define EVLOG_RTC_LAYOUT (EVLOG_RTC_MAX_EVENTS << 8 | 0x1DU)
+#else
+#define EVLOG_RTC_LAYOUT (EVLOG_RTC_MAX_EVENTS << 8 | 0x1AU)
+#endif
+// Like the DRAM log, the cookie comes from the address, here mixed with the layout.
+#define EVLOG_RTC_COOKIE ((uint32_t)((((uintptr_t)EVLOG_RTC_ADDR ^ EVLOG_RTC_LAYOUT) << 1) | 1U))
+
+inline __attribute__((__always_inline__))
+bool IRAM_OPTION rtc_is_inited(void) {
+    return (EVLOG_RTC_COOKIE == p_rtc->cookie);
+}
+
+void IRAM_OPTION evlog_rtc_clear(void) {
+    volatile uint32_t *p = (volatile uint32_t *)p_rtc;
+    for (size_t i = 0; i < EVLOG_RTC_SZ / sizeof(uint32_t); i++)
+        p[i] = 0;
+    p_rtc->cookie = EVLOG_RTC_COOKIE;
+}
+
+// Locked, an EVLOG_RTC() from an ISR must not take the same slot or delta.
+static uint32_t IRAM_OPTION rtc_store(uint16_t id, uint16_t arg, uint32_t ts) {
+    EVLOG_INTR_LOCK();
+    uint32_t num = p_rtc->num;
+    if (num >= EVLOG_RTC_MAX_EVENTS) {
+        num = 0;
+        p_rtc->wrapped = 1U;
+    }
+#ifdef EVLOG_RTC_TS_DELTA
+    uint32_t last_ts = p_rtc->last_ts;
+    p_rtc->last_ts = ts;
+    ts -= last_ts;
+#endif
+    p_rtc->event[num][0] = (uint32_t)arg << 16 | id;
+    p_rtc->event[num][1] = ts;
+    p_rtc->num = num + 1U;
+    EVLOG_INTR_UNLOCK();
+    return num + 1U;
+}
+
+/*
+  Call early on every boot, including wake from deep sleep. A valid log is kept
+  and a wake marker is added to it. Returns false when the log was not valid
+  and has been cleared, or when the DRAM log is using RTC memory.
+*/
+bool evlog_rtc_init(void) {
+    if (EVLOG_STORAGE_RTC == evlog_get_storage(NULL, NULL))
+        return false;
+
+    bool resumed = rtc_is_inited();
+    if (!resumed)
+        evlog_rtc_clear();
+
+    uint32_t wakes = p_rtc->wakes + 1U;
+    p_rtc->wakes = wakes;
+    uint32_t ts = evlog_timestamp();
+#ifdef EVLOG_RTC_TS_DELTA
+    // Time does not carry across a reboot, start deltas over.
+    p_rtc->last_ts = ts;
+#endif
+    rtc_store(EVLOG_RTC_ID_WAKE, (uint16_t)wakes, ts);
+    return resumed;
+}
+
+uint32_t IRAM_OPTION evlog_rtc_event(uint16_t id, uint16_t arg) {
+    if (!rtc_is_inited() || !evlog_is_enable())
+        return 0;
+
+    return rtc_store(id, arg, evlog_timestamp());
+}
+
+uint32_t evlog_rtc_get_count(void) {
+    if (!rtc_is_inited())
+        return 0;
+
+    return (p_rtc->wrapped) ? EVLOG_RTC_MAX_EVENTS : p_rtc->num;
+}
+
+/*
+  Oldest to newest. With EVLOG_RTC_TS_DELTA, `ts` is converted back to the
+  running sum of deltas since the wake marker before it.
+*/
+bool evlog_rtc_get_event(evlog_rtc_entry_t *entry, bool first) {
+    static uint32_t next, left, sum;
+
+    if (!rtc_is_inited())
+        return false;
+
+    if (first) {
+        left = evlog_rtc_get_count();
+        next = (p_rtc->wrapped) ? p_rtc->num : 0U;
+        sum = 0;
+    }
+    if (0 == left)
+        return false;
+
+    if (next >= EVLOG_RTC_MAX_EVENTS)
+        next = 0;
+
+    uint32_t word0 = p_rtc->event[next][0];
+    uint32_t ts = p_rtc->event[next][1];
+    next++;
+    left--;
+
+    entry->id = (uint16_t)word0;
+    entry->arg = (uint16_t)(word0 >> 16);
+#ifdef EVLOG_RTC_TS_DELTA
+    sum = (EVLOG_RTC_ID_WAKE == entry->id) ? 0U : sum + ts;
+    entry->ts = sum;
+#else
+    (void)sum;
+    entry->ts = ts;
+#endif
+    return true;
+}
+
+/*
+  Batched copy of the newest `count` DRAM log events into the RTC log, as
+  fmt ID, (uint16_t)data[0] and timestamp. Call just before deep sleep.
+  Returns the number copied.
+*/
+uint32_t evlog_rtc_save(uint32_t count) {
+    if (!rtc_is_inited())
+        return 0;
+
+    if (count > EVLOG_RTC_MAX_EVENTS)
+        count = EVLOG_RTC_MAX_EVENTS;
+
+    uint32_t total = evlog_get_count();
+    uint32_t skip = (total > count) ? total - count : 0U;
+    uint32_t saved = 0;
+    evlog_entry_t event;
+    bool more = (0 < total) && evlog_get_event(&event, true);
+    for (uint32_t i = 0; i < total; i++) {
+        if (i >= skip) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+            uint32_t ts = event.ts;
+#else
+            uint32_t ts = 0U;
+#endif
+#if (EVLOG_TOTAL_ARGS > 1)
+            rtc_store(evlog_fmt_id(event.fmt), (uint16_t)event.data[0], ts);
+#else
+            rtc_store(evlog_fmt_id(event.fmt), 0U, ts);
+#endif
+            saved++;
+        }
+        if (!more)
+            break;
+        more = evlog_get_event(&event, false);
+    }
+    return saved;
+}
+
+#ifndef EVLOG_HOST
+void evlog_rtc_deep_sleep(uint64_t time_us, uint32_t count) {
+    evlog_rtc_save(count);
+    ESP.deepSleep(time_us);
+}
+#endif
+
+};
+
+void evlogPrintRtcReport(Print& out) {
+  out.println(F("EvLog RTC Report"));
+  uint32_t count = 0;
+  evlog_rtc_entry_t entry;
+  for (bool more = evlog_rtc_get_event(&entry, true); more; more = evlog_rtc_get_event(&entry, false)) {
+    count++;
+    if (EVLOG_RTC_ID_WAKE == entry.id) {
+      out.printf_P(PSTR("  --- wake %u ---\r\n"), entry.arg);
+      continue;
+    }
+    out.printf_P(PSTR("  %10u: "), entry.ts);
+    const char *fmt = evlog_id_fmt(entry.id);
+    if (fmt) {
+      out.printf_P(fmt, entry.arg, 0U, 0U, 0U);
+    } else {
+      out.printf_P(PSTR("< ? >, id %u, 0x%04X"), entry.id, entry.arg);
+    }
+    out.println();
+  }
+  out.printf_P(PSTR("%u RTC Events of a possible %u.\r\n"), count, (uint32_t)EVLOG_RTC_MAX_EVENTS);
+}
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_RTC_H
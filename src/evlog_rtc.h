@@ -0,0 +1,91 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  A compact circular event log in User RTC memory, the only memory that
+  survives deep sleep. An entry is 8 bytes: a 16-bit event ID, a 16-bit
+  argument and a 32-bit timestamp. About 45 entries fit in the 384 bytes past
+  eboot's share.
+
+  Log to it directly with EVLOG_RTC(), or copy the tail of the DRAM log into
+  it with evlog_rtc_save() just before deep sleep.
+
+  It uses the same RTC memory as EVLOG_STORAGE_RTC, only one can be used.
+*/
+#if !defined(EVLOG_RTC_H) && defined(EVLOG_ENABLE)
+#define EVLOG_RTC_H
+
+#include <evlog/src/event_logger.h>
+
+/*
+  Store timestamps as the ticks since the previous RTC entry, instead of the
+  absolute EVLOG_TIMESTAMP value.
+*/
+// #define EVLOG_RTC_TS_DELTA
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+  An ID is the evlog_fmt_id() of a PSTR fmt, the fmt's word offset in the
+  PSTR area plus one. 16 bits of word offset reach the first 256 KB of that
+  area. A fmt past it, or not a PSTR, is stored as EVLOG_RTC_ID_NONE and
+  prints as unknown. evlog_fmt_id() never returns EVLOG_RTC_ID_WAKE. IDs of
+  your own must avoid both.
+*/
+#define EVLOG_RTC_ID_NONE (0U)                        // A fmt with no ID
+#define EVLOG_RTC_ID_WAKE (EVLOG_FMT_ID_MAX + 1U)     // Marks each evlog_rtc_init(), arg is the wake count
+
+typedef struct _EVLOG_RTC_ENTRY {
+    uint16_t id;    // evlog_fmt_id() of a PSTR fmt, or an ID of your own
+    uint16_t arg;
+    uint32_t ts;
+} evlog_rtc_entry_t;
+
+bool evlog_rtc_init(void);
+void evlog_rtc_clear(void);
+uint32_t evlog_rtc_event(uint16_t id, uint16_t arg);
+uint32_t evlog_rtc_get_count(void);
+bool evlog_rtc_get_event(evlog_rtc_entry_t *entry, bool first);
+uint32_t evlog_rtc_save(uint32_t count);
+#ifndef EVLOG_HOST
+void evlog_rtc_deep_sleep(uint64_t time_us, uint32_t count);
+#endif
+
+#ifdef __cplusplus
+};
+#endif
+
+#ifdef Print_h
+void evlogPrintRtcReport(Print& out);
+#endif
+
+#define EVLOG_RTC_P(fmt, arg) evlog_rtc_event(evlog_fmt_id(fmt), (uint16_t)(arg))
+#define EVLOG_RTC(fmt, arg) EVLOG_RTC_P(PSTR(fmt), (arg))
+
+#elif !defined(EVLOG_RTC_H)
+#define EVLOG_RTC_H
+#define evlog_rtc_init() (false)
+#define evlog_rtc_save(count) (0U)
+#define EVLOG_RTC_P(fmt, arg) do{ (void)fmt; (void)arg; }while(false)
+#define EVLOG_RTC EVLOG_RTC_P
+#ifdef Print_h
+inline __attribute__((__always_inline__))
+void evlogPrintRtcReport(Print& out) {
+  (void)out;
+}
+#endif
+#endif
@@ -0,0 +1,122 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Sampled call sites, see evlog_sample.h.
+
+    The counters are a static per call site, placed by the compiler, with no
+    table to size. A site is linked onto a list at its first hit, so reports
+    can find it. Nothing carries over a reboot.
+
+    A countdown, rather than a modulo, picks the hits to log. The ESP8266
+    has no divide instruction.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <evlog/src/evlog_sample.h>
+
+#ifdef EVLOG_SAMPLE_H
+#ifdef EVLOG_ENABLE
+
+extern "C" {
+#define IRAM_OPTION ICACHE_RAM_ATTR
+
+volatile uint32_t evlog_sample_every = 1U;
+static evlog_sample_site_t *sites = NULL;
+
+void IRAM_OPTION evlog_sample_register(evlog_sample_site_t *site, const char *fmt) {
+    EVLOG_INTR_LOCK();
+    // An ISR may have got here first.
+    if (NULL == site->fmt) {
+        site->fmt = fmt;
+        site->next = sites;
+        sites = site;
+    }
+    EVLOG_INTR_UNLOCK();
+}
+
+/*
+  The rate for sites with an N of 0, log 1 in `every` hits, 0 to only count.
+  Returns the previous rate. Takes effect after each site's next entry.
+*/
+uint32_t evlog_sample_set_every(uint32_t every) {
+    uint32_t was = evlog_sample_every;
+    evlog_sample_every = every;
+    return was;
+}
+
+/*
+  Zero the counters. The next hit at each site is logged.
+*/
+void evlog_sample_clear(void) {
+    EVLOG_INTR_LOCK();
+    for (evlog_sample_site_t *site = sites; site; site = site->next) {
+        site->hits = 0U;
+        site->logged = 0U;
+        site->countdown = 0U;
+    }
+    EVLOG_INTR_UNLOCK();
+}
+
+/*
+  The most recently registered site first.
+*/
+const evlog_sample_site_t *evlog_sample_sites(void) {
+    return sites;
+}
+
+const evlog_sample_site_t *evlog_sample_site(const char *fmt) {
+    for (const evlog_sample_site_t *site = sites; site; site = site->next) {
+        if (fmt == site->fmt)
+            return site;
+    }
+    return NULL;
+}
+
+};
+
+void evlogPrintSamples(Print& out) {
+  out.printf_P(PSTR("EvLog Samples, run time rate 1 in %u\r\n"), evlog_sample_every);
+  uint32_t count = 0;
+  for (const evlog_sample_site_t *site = evlog_sample_sites(); site; site = site->next, count++) {
+    evlog_sample_site_t s;
+    {
+      EVLOG_INTR_LOCK();
+      s = *site;
+      EVLOG_INTR_UNLOCK();
+    }
+    out.printf_P(PSTR("  %10u hits %8u logged  1 in %-6u "), s.hits, s.logged,
+        (s.every) ? s.every : evlog_sample_every);
+    if (isPstrFmt(s.fmt)) {
+      out.print('"');
+      out.print(FPSTR(s.fmt));
+      out.print('"');
+    } else {
+      out.printf_P(PSTR("< ? >, 0x%08X"), (uint32_t)(uintptr_t)s.fmt);
+    }
+    out.println();
+  }
+  out.printf_P(PSTR("%u Sampled sites.\r\n"), count);
+}
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_SAMPLE_H
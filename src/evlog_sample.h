@@ -0,0 +1,129 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Sampled logging for busy call sites. Change `EVLOG3("rx %u %u", a, b)` to
+  `EVLOG_SAMPLE3(100, "rx %u %u", a, b)` and only the 1st, 101st, 201st, ...
+  call takes a log entry. Every call is counted, each call site has its own
+  static counters, so the hit count is exact while the log holds 1 in 100.
+
+  An N of 0 uses the run time rate from evlog_sample_set_every(), shared by
+  all such sites. A rate of 0 counts hits and logs nothing.
+
+  evlogPrintReport() shows the site's logged and hit counts after each
+  sampled entry, evlogPrintSamples() lists every site that was hit. Sites
+  are found by fmt pointer, pass a PSTR() used by one site only to
+  EVLOG_SAMPLEn_P(). N must be a constant.
+*/
+#if !defined(EVLOG_SAMPLE_H) && defined(EVLOG_ENABLE)
+#define EVLOG_SAMPLE_H
+
+#include <evlog/src/event_logger.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _EVLOG_SAMPLE_SITE {
+    const char *fmt;        // Set at the first hit
+    uint32_t every;         // 1 in N, 0 for the run time rate
+    uint32_t hits;
+    uint32_t logged;        // Entries taken
+    uint32_t countdown;     // Hits until the next entry
+    struct _EVLOG_SAMPLE_SITE *next;
+} evlog_sample_site_t;
+
+extern volatile uint32_t evlog_sample_every;
+
+void evlog_sample_register(evlog_sample_site_t *site, const char *fmt);
+uint32_t evlog_sample_set_every(uint32_t every);
+void evlog_sample_clear(void);
+const evlog_sample_site_t *evlog_sample_sites(void);
+const evlog_sample_site_t *evlog_sample_site(const char *fmt);
+
+/*
+  Count a hit, true when this one is to be logged.
+*/
+inline __attribute__((__always_inline__, no_instrument_function))
+bool evlog_sample_hit(evlog_sample_site_t *site, const char *fmt) {
+    if (NULL == site->fmt)
+        evlog_sample_register(site, fmt);
+
+    bool take = false;
+    {
+        EVLOG_INTR_LOCK();
+        site->hits++;
+        if (site->countdown) {
+            site->countdown--;
+        } else {
+            uint32_t every = (site->every) ? site->every : evlog_sample_every;
+            if (every) {
+                site->countdown = every - 1U;
+                take = true;
+            }
+        }
+        EVLOG_INTR_UNLOCK();
+    }
+    return take;
+}
+
+#ifdef __cplusplus
+};
+#endif
+
+#ifdef Print_h
+void evlogPrintSamples(Print& out);
+#endif
+
+#define EVLOG_SAMPLE_SITE(n, fmt, log_call) do{ \
+    static evlog_sample_site_t _evlog_site = {NULL, (n), 0U, 0U, 0U, NULL}; \
+    const char *_evlog_fmt = (fmt); \
+    if (evlog_sample_hit(&_evlog_site, _evlog_fmt) && 0U != (log_call)) \
+        _evlog_site.logged++; \
+  }while(false)
+
+#define EVLOG_SAMPLE5_P(n, fmt, val0, val1, val2, val3) EVLOG_SAMPLE_SITE((n), (fmt), EVLOG5_P(_evlog_fmt, (val0), (val1), (val2), (val3)))
+#define EVLOG_SAMPLE4_P(n, fmt, val0, val1, val2) EVLOG_SAMPLE_SITE((n), (fmt), EVLOG4_P(_evlog_fmt, (val0), (val1), (val2)))
+#define EVLOG_SAMPLE3_P(n, fmt, val0, val1) EVLOG_SAMPLE_SITE((n), (fmt), EVLOG3_P(_evlog_fmt, (val0), (val1)))
+#define EVLOG_SAMPLE2_P(n, fmt, val0) EVLOG_SAMPLE_SITE((n), (fmt), EVLOG2_P(_evlog_fmt, (val0)))
+#define EVLOG_SAMPLE1_P(n, fmt) EVLOG_SAMPLE_SITE((n), (fmt), EVLOG1_P(_evlog_fmt))
+
+#define EVLOG_SAMPLE5(n, fmt, val0, val1, val2, val3) EVLOG_SAMPLE5_P((n), PSTR(fmt), (val0), (val1), (val2), (val3))
+#define EVLOG_SAMPLE4(n, fmt, val0, val1, val2) EVLOG_SAMPLE4_P((n), PSTR(fmt), (val0), (val1), (val2))
+#define EVLOG_SAMPLE3(n, fmt, val0, val1) EVLOG_SAMPLE3_P((n), PSTR(fmt), (val0), (val1))
+#define EVLOG_SAMPLE2(n, fmt, val0) EVLOG_SAMPLE2_P((n), PSTR(fmt), (val0))
+#define EVLOG_SAMPLE1(n, fmt) EVLOG_SAMPLE1_P((n), PSTR(fmt))
+
+#elif !defined(EVLOG_SAMPLE_H)
+#define EVLOG_SAMPLE_H
+#define evlog_sample_set_every(every) (0U)
+#define evlog_sample_clear() do{}while(false)
+#define EVLOG_SAMPLE5_P(n, fmt, val0, val1, val2, val3) do{ (void)(n); (void)fmt; (void)val0; (void)val1; (void)val2; (void)val3; }while(false)
+#define EVLOG_SAMPLE4_P(n, fmt, val0, val1, val2) do{ (void)(n); (void)fmt; (void)val0; (void)val1; (void)val2; }while(false)
+#define EVLOG_SAMPLE3_P(n, fmt, val0, val1) do{ (void)(n); (void)fmt; (void)val0; (void)val1; }while(false)
+#define EVLOG_SAMPLE2_P(n, fmt, val0) do{ (void)(n); (void)fmt; (void)val0; }while(false)
+#define EVLOG_SAMPLE1_P(n, fmt) do{ (void)(n); (void)fmt; }while(false)
+#define EVLOG_SAMPLE5 EVLOG_SAMPLE5_P
+#define EVLOG_SAMPLE4 EVLOG_SAMPLE4_P
+#define EVLOG_SAMPLE3 EVLOG_SAMPLE3_P
+#define EVLOG_SAMPLE2 EVLOG_SAMPLE2_P
+#define EVLOG_SAMPLE1 EVLOG_SAMPLE1_P
+#ifdef Print_h
+inline __attribute__((__always_inline__))
+void evlogPrintSamples(Print& out) {
+  (void)out;
+}
+#endif
+#endif
@@ -0,0 +1,243 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Span events, see evlog_span.h.
+
+    Open spans are kept on a small stack, with their start time, so the end
+    event can carry the duration and the threshold can be applied before
+    anything is logged. A span begun with the stack full is not tracked,
+    evlog_span_begin() returns 0 and its end is ignored. Spans are expected
+    to end in order, one ending out of order closes only itself.
+
+    A duration is less the cost of the span events logged while the span
+    was open, evlog_get_overhead() each. That is its own begin, and the
+    begin and end of the spans inside it. Other events logged inside it
+    are not taken off.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <evlog/src/evlog_span.h>
+
+#ifdef EVLOG_SPAN_H
+#if defined(EVLOG_ENABLE) && (EVLOG_TOTAL_ARGS > 4)
+
+extern "C" {
+#define IRAM_OPTION ICACHE_RAM_ATTR
+
+typedef struct _EVLOG_SPAN_OPEN {
+    uint32_t word;      // ID and depth
+    const char *fmt;
+    uint32_t arg;
+    uint32_t start;
+    uint32_t logged;    // span_logged at the start
+} evlog_span_open_t;
+
+// One copy of each, so the report can find them by address.
+static inline __attribute__((__always_inline__))
+const char *span_begin_fmt(void) {
+    return PSTR(EVLOG_SPAN_BEGIN_FMT);
+}
+
+static inline __attribute__((__always_inline__))
+const char *span_end_fmt(void) {
+    return PSTR(EVLOG_SPAN_END_FMT);
+}
+
+static evlog_span_open_t open_spans[EVLOG_SPAN_DEPTH];
+static uint32_t open_count = 0;
+static uint32_t next_id = 0;
+static uint32_t threshold = 0;
+static uint32_t span_logged = 0;    // Span events logged, only the difference counts
+
+/*
+  0 logs every begin and end. Otherwise only spans of `ticks` or more are
+  logged, when they end. Returns the previous setting.
+*/
+uint32_t evlog_span_set_threshold(uint32_t ticks) {
+    uint32_t was = threshold;
+    threshold = ticks;
+    return was;
+}
+
+/*
+  Returns the span ID, or 0 when it could not be tracked.
+*/
+uint32_t IRAM_OPTION evlog_span_begin(const char *fmt, uint32_t arg) {
+    if (!evlog_is_enable())
+        return 0U;
+
+    uint32_t word = 0;
+    {
+        EVLOG_INTR_LOCK();
+        if (EVLOG_SPAN_DEPTH > open_count) {
+            next_id = (next_id + 1U) & 0xFFFFU;
+            if (0U == next_id)
+                next_id = 1U;
+            word = next_id | open_count << 16;
+            if (threshold)
+                word |= EVLOG_SPAN_F_THRESHOLD;
+            evlog_span_open_t *span = &open_spans[open_count++];
+            span->word = word;
+            span->fmt = fmt;
+            span->arg = arg;
+            span->logged = span_logged;
+            span->start = evlog_timestamp();
+        }
+        EVLOG_INTR_UNLOCK();
+    }
+    if (0U != word && 0U == (word & EVLOG_SPAN_F_THRESHOLD) &&
+        EVLOG4_P(span_begin_fmt(), word, (uint32_t)((uintptr_t)fmt - evlog_image_base()), arg))
+        span_logged++;
+
+    return EVLOG_SPAN_ID(word);
+}
+
+/*
+  Returns the duration in timestamp ticks, less the logging overhead.
+*/
+uint32_t IRAM_OPTION evlog_span_end(uint32_t id) {
+    uint32_t now = evlog_timestamp();
+    if (0U == id)
+        return 0U;
+
+    evlog_span_open_t span = {0U, NULL, 0U, 0U, 0U};
+    uint32_t events = 0U;
+    {
+        EVLOG_INTR_LOCK();
+        for (uint32_t i = open_count; i > 0U; i--) {
+            if (id == EVLOG_SPAN_ID(open_spans[i - 1U].word)) {
+                span = open_spans[i - 1U];
+                events = span_logged - span.logged;
+                for (; i < open_count; i++)
+                    open_spans[i - 1U] = open_spans[i];
+                open_count--;
+                break;
+            }
+        }
+        EVLOG_INTR_UNLOCK();
+    }
+    if (NULL == span.fmt)
+        return 0U;
+
+    uint32_t ticks = now - span.start;
+    uint32_t overhead = events * evlog_get_overhead();
+    ticks = (ticks > overhead) ? ticks - overhead : 0U;
+    if ((0U == (span.word & EVLOG_SPAN_F_THRESHOLD) || ticks >= threshold) &&
+        EVLOG5_P(span_end_fmt(), span.word, (uint32_t)((uintptr_t)span.fmt - evlog_image_base()), span.arg, ticks))
+        span_logged++;
+
+    return ticks;
+}
+
+};
+
+static uint32_t ticks_to_us(uint32_t ticks) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+    return ticks / clockCyclesPerMicrosecond();
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    return ticks * 1000U;
+#else
+    return ticks;
+#endif
+}
+
+#ifndef EVLOG_SPAN_REPORT_MAX
+#define EVLOG_SPAN_REPORT_MAX (16U)     // Span names totaled by evlogPrintSpans()
+#endif
+
+/*
+  Lists the completed spans in the log, indented by depth, then the count,
+  min, max and total of each span name, in us.
+*/
+void evlogPrintSpans(Print& out) {
+  struct {
+    uint32_t name;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+  } totals[EVLOG_SPAN_REPORT_MAX];
+  size_t names = 0;
+  uint32_t spans = 0;
+  uintptr_t base = evlog_image_base();
+
+  out.println(F("EvLog Spans"));
+  uint32_t state = evlog_stop();
+  uint32_t count = evlog_get_count();
+  evlog_entry_t event;
+  bool more = true;
+  for (uint32_t i = 0; more && i < count; i++) {
+    more = evlog_get_event(&event, (0U == i));
+    if (span_end_fmt() != event.fmt)
+      continue;
+
+    spans++;
+    uint32_t word = event.data[0];
+    const char *name = (const char *)(base + event.data[1]);
+    uint32_t us = ticks_to_us(event.data[3]);
+    out.printf_P(PSTR("  %10u us %*s#%u "), us, (int)(2U * EVLOG_SPAN_DEPTH_OF(word)), "", EVLOG_SPAN_ID(word));
+    if (isPstrFmt(name))
+      out.printf_P(name, event.data[2]);
+    else
+      out.printf_P(PSTR("< ? >, 0x%08X"), event.data[1]);
+    out.println();
+
+    size_t n = 0;
+    while (n < names && totals[n].name != event.data[1])
+      n++;
+    if (n == names) {
+      if (EVLOG_SPAN_REPORT_MAX == names)
+        continue;
+      names++;
+      totals[n].name = event.data[1];
+      totals[n].count = 0;
+      totals[n].min = UINT32_MAX;
+      totals[n].max = 0;
+      totals[n].total = 0;
+    }
+    totals[n].count++;
+    totals[n].total += us;
+    if (us < totals[n].min)
+      totals[n].min = us;
+    if (us > totals[n].max)
+      totals[n].max = us;
+  }
+  evlog_set_state(state);
+
+  out.printf_P(PSTR("%u completed spans.\r\n"), spans);
+  if (0 == names)
+    return;
+
+  out.println(F("       count      min us      max us    total us  span"));
+  for (size_t n = 0; n < names; n++) {
+    out.printf_P(PSTR("  %10u  %10u  %10u  %10u  "), totals[n].count, totals[n].min, totals[n].max, (uint32_t)totals[n].total);
+    const char *name = (const char *)(base + totals[n].name);
+    if (isPstrFmt(name))
+      out.print(FPSTR(name));
+    else
+      out.printf_P(PSTR("< ? >, 0x%08X"), totals[n].name);
+    out.println();
+  }
+}
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_SPAN_H
@@ -0,0 +1,116 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Spans, begin/end pairs with the duration worked out for you.
+
+    uint32_t span = EVLOG_BEGIN("flash read 0x%08X", addr);
+    ...
+    EVLOG_END(span);
+
+  or in C++, for the rest of the scope:
+
+    EVLOG_SPAN("flash read 0x%08X", addr);
+
+  Spans nest, each gets an ID and its depth. The end event carries the
+  duration in timestamp ticks, less evlog_get_overhead() for each span
+  event logged inside the span, its own begin included. Run
+  evlog_calibrate() first for that. Other events logged inside the span are
+  not taken off. evlogPrintSpans() lists the spans with per span count,
+  min, max and total, host/evlog_spans does the same from a dump.
+
+  evlog_span_set_threshold(ticks) stops logging the begin event and logs
+  only spans that complete and took at least `ticks`, so quick spans do not
+  use up the log.
+
+  Spans need EVLOG_TOTAL_ARGS of 5.
+*/
+#include <evlog/src/event_logger.h>
+
+#if !defined(EVLOG_SPAN_H) && defined(EVLOG_ENABLE) && (EVLOG_TOTAL_ARGS > 4)
+#define EVLOG_SPAN_H
+
+#ifndef EVLOG_SPAN_DEPTH
+#define EVLOG_SPAN_DEPTH (8U)       // Spans open at once
+#endif
+
+/*
+  Span events, found by these format strings. The first word holds the span
+  ID in bits 0-15, the depth in bits 16-23, and EVLOG_SPAN_F_THRESHOLD when
+  the begin was not logged. The name is the span's fmt, relative to
+  evlog_image_base().
+*/
+#define EVLOG_SPAN_BEGIN_FMT "EvSpan> 0x%08X, name 0x%08X, arg %u"
+#define EVLOG_SPAN_END_FMT   "EvSpan< 0x%08X, name 0x%08X, arg %u, %u ticks"
+#define EVLOG_SPAN_F_THRESHOLD (0x80000000U)
+#define EVLOG_SPAN_ID(word)    ((word) & 0xFFFFU)
+#define EVLOG_SPAN_DEPTH_OF(word) (((word) >> 16) & 0xFFU)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t evlog_span_begin(const char *fmt, uint32_t arg);
+uint32_t evlog_span_end(uint32_t id);
+uint32_t evlog_span_set_threshold(uint32_t ticks);
+
+#ifdef __cplusplus
+};
+#endif
+
+#ifdef __cplusplus
+class EvlogSpan {
+public:
+    __attribute__((no_instrument_function))
+    EvlogSpan(const char *fmt, uint32_t arg = 0U) : id(evlog_span_begin(fmt, arg)) {}
+    __attribute__((no_instrument_function))
+    ~EvlogSpan() { evlog_span_end(id); }
+    EvlogSpan(const EvlogSpan&) = delete;
+    EvlogSpan& operator=(const EvlogSpan&) = delete;
+
+private:
+    uint32_t id;
+};
+
+#define EVLOG_SPAN_CAT_(a, b) a ## b
+#define EVLOG_SPAN_CAT(a, b) EVLOG_SPAN_CAT_(a, b)
+#define EVLOG_SPAN_P(fmt, arg) \
+    EvlogSpan EVLOG_SPAN_CAT(evlog_span_, __LINE__)((fmt), (uint32_t)(arg))
+#define EVLOG_SPAN(fmt, arg) EVLOG_SPAN_P(PSTR(fmt), (arg))
+#endif
+
+#ifdef Print_h
+void evlogPrintSpans(Print& out);
+#endif
+
+#define EVLOG_BEGIN_P(fmt, arg) evlog_span_begin((fmt), (uint32_t)(arg))
+#define EVLOG_BEGIN(fmt, arg) EVLOG_BEGIN_P(PSTR(fmt), (arg))
+#define EVLOG_END(id) evlog_span_end(id)
+
+#elif !defined(EVLOG_SPAN_H)
+#define EVLOG_SPAN_H
+#define evlog_span_set_threshold(ticks) (0U)
+#define EVLOG_BEGIN_P(fmt, arg) ((void)(fmt), (void)(arg), 0U)
+#define EVLOG_BEGIN EVLOG_BEGIN_P
+#define EVLOG_END(id) do{ (void)(id); }while(false)
+#define EVLOG_SPAN_P(fmt, arg) do{ (void)(fmt); (void)(arg); }while(false)
+#define EVLOG_SPAN EVLOG_SPAN_P
+#ifdef Print_h
+inline __attribute__((__always_inline__))
+void evlogPrintSpans(Print& out) {
+  (void)out;
+}
+#endif
+#endif
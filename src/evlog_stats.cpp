@@ -0,0 +1,160 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Per format string aggregates, see evlog_stats.h.
+
+    The table is a plain static array next to the log, it does not carry over
+    a reboot. A format string gets a row the first time it is seen, and keeps
+    it until evlog_stats_clear(). Rows are found by pointer, one PSTR() per
+    call site, so two call sites with the same text get two rows.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <evlog/src/evlog_stats.h>
+
+#ifdef EVLOG_STATS_H
+#ifdef EVLOG_ENABLE
+
+extern "C" {
+#define IRAM_OPTION ICACHE_RAM_ATTR
+
+static evlog_stat_t stats[EVLOG_STATS_MAX];
+
+static inline __attribute__((__always_inline__))
+uint32_t IRAM_OPTION stat_bin(uint32_t value) {
+    uint32_t bin = (0U == value) ? 0U : 32U - (uint32_t)__builtin_clz(value);
+    return (bin < EVLOG_STATS_BINS) ? bin : EVLOG_STATS_BINS - 1U;
+}
+
+/*
+  Returns the sample count for `fmt`, or 0 when logging is stopped or the
+  table was full and an EVLOG2 event was logged instead.
+*/
+uint32_t IRAM_OPTION evlog_stat(const char *fmt, uint32_t value) {
+    if (!evlog_is_enable())
+        return 0U;
+
+    uint32_t count = 0;
+    {
+        EVLOG_INTR_LOCK();
+        evlog_stat_t *row = NULL;
+        for (size_t i = 0; i < EVLOG_STATS_MAX; i++) {
+            if (fmt == stats[i].fmt || NULL == stats[i].fmt) {
+                row = &stats[i];
+                break;
+            }
+        }
+        if (row) {
+            if (NULL == row->fmt || 0U == row->count) {
+                row->fmt = fmt;
+                row->min = value;
+                row->max = value;
+            } else if (value < row->min) {
+                row->min = value;
+            } else if (value > row->max) {
+                row->max = value;
+            }
+            row->sum += value;
+            row->sumsq += (uint64_t)value * value;
+            row->hist[stat_bin(value)]++;
+            count = ++row->count;
+        }
+        EVLOG_INTR_UNLOCK();
+    }
+    if (0U == count)
+        EVLOG2_P(fmt, value);
+
+    return count;
+}
+
+void evlog_stats_clear(void) {
+    EVLOG_INTR_LOCK();
+    memset(stats, 0, sizeof(stats));
+    EVLOG_INTR_UNLOCK();
+}
+
+/*
+  Row `index`, or NULL past the last one in use.
+*/
+const evlog_stat_t *evlog_stats_get(size_t index) {
+    if (EVLOG_STATS_MAX <= index || NULL == stats[index].fmt)
+        return NULL;
+
+    return &stats[index];
+}
+
+};
+
+static uint32_t isqrt64(uint64_t x) {
+    uint64_t r = 0;
+    for (uint64_t bit = 1ULL << 62; bit; bit >>= 2) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+    }
+    return (uint32_t)r;
+}
+
+void evlogPrintStats(Print& out) {
+  out.println(F("EvLog Stats"));
+  size_t rows = 0;
+  for (const evlog_stat_t *row; NULL != (row = evlog_stats_get(rows)); rows++) {
+    // Copy, so an ISR does not change it part way through printing.
+    evlog_stat_t s;
+    {
+      EVLOG_INTR_LOCK();
+      s = *row;
+      EVLOG_INTR_UNLOCK();
+    }
+    out.print(F("  \""));
+    if (isPstrFmt(s.fmt)) {
+      out.print(FPSTR(s.fmt));
+      out.print('"');
+    } else {
+      out.printf_P(PSTR("< ? >, 0x%08X"), (uint32_t)(uintptr_t)s.fmt);
+    }
+    out.println();
+    uint64_t mean = (s.count) ? s.sum / s.count : 0U;
+    uint64_t var = (s.count) ? s.sumsq / s.count - mean * mean : 0U;
+    out.printf_P(PSTR("    count %u, min %u, max %u, mean %u, std dev %u\r\n"),
+        s.count, s.min, s.max, (uint32_t)mean, isqrt64(var));
+    out.print(F("    log2 hist:"));
+    for (uint32_t bin = 0; bin < EVLOG_STATS_BINS; bin++) {
+      if (0U == s.hist[bin])
+        continue;
+      uint32_t lo = (0U == bin) ? 0U : 1U << (bin - 1U);
+      if (EVLOG_STATS_BINS - 1U == bin)
+        out.printf_P(PSTR(" [%u+] %u"), lo, s.hist[bin]);
+      else
+        out.printf_P(PSTR(" [%u] %u"), lo, s.hist[bin]);
+    }
+    out.println();
+  }
+  out.printf_P(PSTR("%u Stats rows of a possible %u.\r\n"), (uint32_t)rows, (uint32_t)EVLOG_STATS_MAX);
+}
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_STATS_H
@@ -0,0 +1,82 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Aggregate, instead of log, the events of busy call sites. Change
+  `EVLOG2("lat %u", x)` to `EVLOG_STAT("lat %u", x)` and each call updates
+  the count, min, max, sum, sum of squares and a log2 histogram of `x` kept
+  for that format string, rather than taking a log entry.
+
+  The table holds EVLOG_STATS_MAX format strings. When it is full, a new
+  format string is logged as an EVLOG2 event instead.
+*/
+#if !defined(EVLOG_STATS_H) && defined(EVLOG_ENABLE)
+#define EVLOG_STATS_H
+
+#include <evlog/src/event_logger.h>
+
+#ifndef EVLOG_STATS_MAX
+#define EVLOG_STATS_MAX (8U)
+#endif
+
+/*
+  Bin 0 counts zeros, bin n counts values of n bits, 2^(n-1) to 2^n - 1. The
+  last bin takes everything larger.
+*/
+#ifndef EVLOG_STATS_BINS
+#define EVLOG_STATS_BINS (16U)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _EVLOG_STAT {
+    const char *fmt;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint64_t sumsq;     // Wraps for values over 2^16 after 2^32 samples
+    uint32_t hist[EVLOG_STATS_BINS];
+} evlog_stat_t;
+
+uint32_t evlog_stat(const char *fmt, uint32_t value);
+void evlog_stats_clear(void);
+const evlog_stat_t *evlog_stats_get(size_t index);
+
+#ifdef __cplusplus
+};
+#endif
+
+#ifdef Print_h
+void evlogPrintStats(Print& out);
+#endif
+
+#define EVLOG_STAT_P(fmt, val0) evlog_stat((fmt), (uint32_t)(val0))
+#define EVLOG_STAT(fmt, val0) EVLOG_STAT_P(PSTR(fmt), (val0))
+
+#elif !defined(EVLOG_STATS_H)
+#define EVLOG_STATS_H
+#define evlog_stats_clear() do{}while(false)
+#define EVLOG_STAT_P(fmt, val0) do{ (void)fmt; (void)val0; }while(false)
+#define EVLOG_STAT EVLOG_STAT_P
+#ifdef Print_h
+inline __attribute__((__always_inline__))
+void evlogPrintStats(Print& out) {
+  (void)out;
+}
+#endif
+#endif
@@ -0,0 +1,223 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+    Chrome trace event JSON writer, see evlog_trace.h.
+
+    Each event is formatted and written as it is read, with a few hundred
+    bytes of stack. Logging is stopped while the trace is written.
+
+    Format strings are copied out of flash before they are compared, flash
+    only takes 32-bit reads.
+*/
+#ifdef EVLOG_HOST
+#include <evlog/src/evlog_host.h>
+#else
+#include <Arduino.h>
+#include <Print.h>
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <evlog/src/evlog_trace.h>
+#include <evlog/src/evlog_print.h>
+#include <evlog/src/evlog_span.h>
+#include <evlog/src/evlog_profiler.h>
+
+#ifdef EVLOG_TRACE_H
+#ifdef EVLOG_ENABLE
+
+static void print_u64(Print& out, uint64_t value) {
+  uint32_t hi = (uint32_t)(value / 1000000000U);
+  uint32_t lo = (uint32_t)(value % 1000000000U);
+  if (hi)
+    out.printf_P(PSTR("%u%09u"), hi, lo);
+  else
+    out.printf_P(PSTR("%u"), lo);
+}
+
+static uint64_t ticks_to_ns(uint64_t ticks) {
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES)
+  return ticks * 1000U / clockCyclesPerMicrosecond();
+#elif (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+  return ticks * 1000000U;
+#else
+  return ticks * 1000U;
+#endif
+}
+
+/*
+  Trace timestamps are in us, to the ns.
+*/
+static void print_us(Print& out, uint64_t ns) {
+  print_u64(out, ns / 1000U);
+  out.printf_P(PSTR(".%03u"), (uint32_t)(ns % 1000U));
+}
+
+static void print_json_string(Print& out, const char *s) {
+  out.print('"');
+  for (; *s; s++) {
+    char c = *s;
+    if ('"' == c || '\\' == c) {
+      out.print('\\');
+      out.print(c);
+    } else if ((unsigned char)c < 0x20U) {
+      out.printf_P(PSTR("\\u%04x"), (unsigned)c);
+    } else {
+      out.print(c);
+    }
+  }
+  out.print('"');
+}
+
+static void start_event(Print& out, const char *ph, uint64_t ns) {
+  out.print(F(",\n{\"pid\":1,\"tid\":1,\"ph\":\""));
+  out.print(FPSTR(ph));
+  out.print(F("\",\"ts\":"));
+  print_us(out, ns);
+}
+
+static void format_event(char *buf, size_t size, const evlog_entry_t& event) {
+  snprintf_P(buf, size, event.fmt
+#if (EVLOG_TOTAL_ARGS > 1)
+      , event.data[0]
+#endif
+#if (EVLOG_TOTAL_ARGS > 2)
+      , event.data[1]
+#endif
+#if (EVLOG_TOTAL_ARGS > 3)
+      , event.data[2]
+#endif
+#if (EVLOG_TOTAL_ARGS > 4)
+      , event.data[3]
+#endif
+  );
+}
+
+/*
+  Stops at the first short write, the rest would not reach the file.
+*/
+static void write_trace(EvlogCountPrint& out) {
+  char fmt[96];
+  char text[128];
+  uintptr_t base = evlog_image_base();
+  size_t prefix_len = strlen(EVLOG_COUNTER_PREFIX);
+
+  out.print(F("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+              "{\"pid\":1,\"tid\":1,\"ph\":\"M\",\"name\":\"process_name\",\"args\":{\"name\":\"EvLog\"}}"));
+
+  // UTC from clock records when there are some, else from the first entry.
+  evlog_clock_map_t clock;
+  bool wall_clock = evlog_clock_map_begin(&clock);
+  uint32_t count = evlog_get_count();
+  uint64_t now = 0;
+  uint32_t last_ts = 0;
+  evlog_entry_t event;
+  bool more = true;
+  for (uint32_t i = 0; out.ok && more && i < count; i++) {
+    more = evlog_get_event(&event, (0U == i));
+#if (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_CLOCKCYCLES) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MICROS) || \
+    (EVLOG_TIMESTAMP == EVLOG_TIMESTAMP_MILLIS)
+    uint64_t utc_us;
+    if (wall_clock && evlog_clock_map_next(&clock, &event, &utc_us)) {
+      now = utc_us * 1000U;
+    } else {
+      now += (0U == i) ? 0U : ticks_to_ns((uint32_t)(event.ts - last_ts));
+    }
+    last_ts = event.ts;
+#else
+    // No timestamps, keep the order with 1 us per event.
+    (void)last_ts;
+    (void)wall_clock;
+    now = i * 1000U;
+#endif
+
+    if (!isPstrFmt(event.fmt)) {
+      start_event(out, PSTR("i"), now);
+      out.printf_P(PSTR(",\"s\":\"t\",\"name\":\"< ? > 0x%08X\"}"), (uint32_t)(uintptr_t)event.fmt);
+      continue;
+    }
+    strncpy_P(fmt, event.fmt, sizeof(fmt) - 1U);
+    fmt[sizeof(fmt) - 1U] = '\0';
+
+#ifdef EVLOG_SPAN_END_FMT
+    if (0 == strcmp(fmt, EVLOG_SPAN_BEGIN_FMT))
+      continue;   // The slice is written at the end event
+
+    if (0 == strcmp(fmt, EVLOG_SPAN_END_FMT)) {
+      const char *name = (const char *)(base + event.data[1]);
+      if (isPstrFmt(name))
+        snprintf_P(text, sizeof(text), name, event.data[2]);
+      else
+        snprintf_P(text, sizeof(text), PSTR("< ? > 0x%08X"), event.data[1]);
+      uint64_t dur = ticks_to_ns(event.data[3]);
+      start_event(out, PSTR("X"), (now > dur) ? now - dur : 0U);
+      out.print(F(",\"dur\":"));
+      print_us(out, dur);
+      out.print(F(",\"name\":"));
+      print_json_string(out, text);
+      out.printf_P(PSTR(",\"args\":{\"id\":%u,\"depth\":%u}}"),
+          EVLOG_SPAN_ID(event.data[0]), EVLOG_SPAN_DEPTH_OF(event.data[0]));
+      continue;
+    }
+#endif
+#ifdef EVLOG_PROFILER_ENTER_FMT
+    bool enter = (0 == strcmp(fmt, EVLOG_PROFILER_ENTER_FMT));
+    if (enter || 0 == strcmp(fmt, EVLOG_PROFILER_EXIT_FMT)) {
+      start_event(out, (enter) ? PSTR("B") : PSTR("E"), now);
+      out.printf_P(PSTR(",\"name\":\"0x%08X\"}"), event.data[0]);
+      continue;
+    }
+#endif
+    if (0 == strncmp(fmt, EVLOG_COUNTER_PREFIX, prefix_len)) {
+      char *name = &fmt[prefix_len];
+      char *end = strchr(name, ' ');
+      if (end)
+        *end = '\0';
+      start_event(out, PSTR("C"), now);
+      out.print(F(",\"name\":"));
+      print_json_string(out, name);
+#if (EVLOG_TOTAL_ARGS > 1)
+      out.printf_P(PSTR(",\"args\":{\"value\":%u}}"), event.data[0]);
+#else
+      out.print(F(",\"args\":{\"value\":0}}"));
+#endif
+      continue;
+    }
+
+    format_event(text, sizeof(text), event);
+    start_event(out, PSTR("i"), now);
+    out.print(F(",\"s\":\"t\",\"name\":"));
+    print_json_string(out, text);
+    out.print('}');
+  }
+  out.print(F("\n]}\n"));
+}
+
+/*
+  Returns false when `out` did not take all of it.
+*/
+bool evlogWriteChromeTrace(Print& out) {
+  EvlogCountPrint counted(out);
+  uint32_t state = evlog_stop();
+  write_trace(counted);
+  evlog_set_state(state);
+  return counted.ok;
+}
+
+#endif // EVLOG_ENABLE
+#endif // EVLOG_TRACE_H
@@ -0,0 +1,57 @@
+/*
+ *   Copyright 2019 M Hightower
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+  Chrome trace event JSON export, for chrome://tracing or ui.perfetto.dev.
+
+  evlogWriteChromeTrace(out) streams the log to a Print as it goes, no
+  buffer for the whole trace is needed. host/evlog_trace writes the same
+  from a dump, with function names for profiler events. It returns false
+  when `out` takes less than was written, a full disk or a closed stream.
+
+    * Events become instant events, named by their formatted text.
+    * EVLOG_COUNTER("heap", value) events become a counter track.
+    * Span end events (evlog_span.h) become duration slices.
+    * Profiler enter/exit events (evlog_profiler.h) become nested slices.
+
+  Timestamps are UTC when the log holds evlog_clock_sync() records, else
+  from the first event. They are unwrapped, assuming no gap between events
+  is longer than the wrap time of EVLOG_TIMESTAMP.
+*/
+#include <evlog/src/event_logger.h>
+
+#if !defined(EVLOG_TRACE_H) && defined(EVLOG_ENABLE)
+#define EVLOG_TRACE_H
+
+// Counter events are found by this prefix, the name runs to the next space.
+#define EVLOG_COUNTER_PREFIX "Cnt "
+
+#define EVLOG_COUNTER(name, value) EVLOG2_P(PSTR(EVLOG_COUNTER_PREFIX name " %u"), (value))
+
+#ifdef Print_h
+bool evlogWriteChromeTrace(Print& out);
+#endif
+
+#elif !defined(EVLOG_TRACE_H)
+#define EVLOG_TRACE_H
+#define EVLOG_COUNTER(name, value) do{ (void)(value); }while(false)
+#ifdef Print_h
+inline __attribute__((__always_inline__))
+bool evlogWriteChromeTrace(Print& out) {
+  (void)out;
+  return false;
+}
+#endif
+#endif
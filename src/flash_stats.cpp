@@ -106,6 +106,7 @@ void ICACHE_RAM_ATTR flash_addr_match_stats(uint32_t addr, void *sd, uint32_t si
     esp_flash_data_t *p_flash_count = (write) ? &flash_log.w_count : &flash_log.r_count;
     bool write_log = true; // write  // Change "true" to "write" to only EVLOG writes
     init_flash_stats();
+    p_flash_count->all++;
 
     uint32_t addr_sector = MK_SECTOR_ALIGN(addr);
     if (flash_log.match.xxB <= addr_sector) {
@@ -238,26 +239,30 @@ int ICACHE_RAM_ATTR FlashDwnLdParamCfgMsgProc(uint32_t a, uint32_t b) {
 
 #include <Esp.h>
 #include <Print.h>
-#define String_F(a) String(F(a))
-void printFlashStatsReport(Print& oStream) {
-  oStream.println(String_F("System Area Flash Access"));
-  oStream.println(String_F("  R/W count 0x...FBxxx:     ") + (flash_log.r_count.xxB) + "/" + (flash_log.w_count.xxB));
-  oStream.println(String_F("  R/W count 0x...FCxxx:     ") + (flash_log.r_count.xxC) + "/" + (flash_log.w_count.xxC));
-  oStream.println(String_F("  R/W count 0x...FDxxx:     ") + (flash_log.r_count.xxD) + "/" + (flash_log.w_count.xxD));
-  oStream.println(String_F("  R/W count 0x...FExxx:     ") + (flash_log.r_count.xxE) + "/" + (flash_log.w_count.xxE));
-  oStream.println(String_F("  R/W count 0x...FFxxx:     ") + (flash_log.r_count.xxF) + "/" + (flash_log.w_count.xxF));
+#include <evlog/src/evlog_print.h>
+
+void printFlashStatsReport(Print& printer) {
+  char buf[EVLOG_REPORT_BUFFER];
+  EvlogBufferPrint oStream(printer, buf, sizeof(buf));
+  oStream.print(F("System Area Flash Access\r\n"));
+  oStream.printf_P(PSTR("  R/W count all:            %u/%u\r\n"), flash_log.r_count.all, flash_log.w_count.all);
+  oStream.printf_P(PSTR("  R/W count 0x...FBxxx:     %u/%u\r\n"), flash_log.r_count.xxB, flash_log.w_count.xxB);
+  oStream.printf_P(PSTR("  R/W count 0x...FCxxx:     %u/%u\r\n"), flash_log.r_count.xxC, flash_log.w_count.xxC);
+  oStream.printf_P(PSTR("  R/W count 0x...FDxxx:     %u/%u\r\n"), flash_log.r_count.xxD, flash_log.w_count.xxD);
+  oStream.printf_P(PSTR("  R/W count 0x...FExxx:     %u/%u\r\n"), flash_log.r_count.xxE, flash_log.w_count.xxE);
+  oStream.printf_P(PSTR("  R/W count 0x...FFxxx:     %u/%u\r\n"), flash_log.r_count.xxF, flash_log.w_count.xxF);
   if (flash_log.r_count.range_error || flash_log.w_count.range_error)
-  oStream.println(String_F("  R/W range error:          ") + (flash_log.r_count.range_error) + "/" + (flash_log.w_count.range_error));
-  oStream.println(String_F("  R/W PHY Init Data:        ") + (flash_log.r_count.pre_init)  + "/" + (flash_log.w_count.pre_init));
-  oStream.println(String_F("  R/W RF_CAL:               ") + (flash_log.r_count.post_init) + "/" + (flash_log.w_count.post_init));
+  oStream.printf_P(PSTR("  R/W range error:          %u/%u\r\n"), flash_log.r_count.range_error, flash_log.w_count.range_error);
+  oStream.printf_P(PSTR("  R/W PHY Init Data:        %u/%u\r\n"), flash_log.r_count.pre_init, flash_log.w_count.pre_init);
+  oStream.printf_P(PSTR("  R/W RF_CAL:               %u/%u\r\n"), flash_log.r_count.post_init, flash_log.w_count.post_init);
 
-  oStream.println(String_F("  match_0xFC:               0x0") + String(flash_log.match.xxC, HEX));
+  oStream.printf_P(PSTR("  match_0xFC:               0x0%x\r\n"), flash_log.match.xxC);
   if (flash_log.address)
-  oStream.println(String_F("  address (should be 0):    0x0") + String(flash_log.address, HEX));
-  oStream.println(String_F("  flash_log.flash_size:     0x0") + String(flash_log.chip_size, HEX)        + (", ") + String(flash_log.chip_size));
-  oStream.println(String_F("  flashchip->chip_size:     0x0") + String(flashchip->chip_size, HEX)       + (", ") + String(flashchip->chip_size));
-  oStream.println(String_F("  ESP.getFlashChipSize:     0x0") + String(ESP.getFlashChipSize(), HEX)     + (", ") + String(ESP.getFlashChipSize()));
-  oStream.println(String_F("  ESP.getFlashChipRealSize: 0x0") + String(ESP.getFlashChipRealSize(), HEX) + (", ") + String(ESP.getFlashChipRealSize()));
+  oStream.printf_P(PSTR("  address (should be 0):    0x0%x\r\n"), flash_log.address);
+  oStream.printf_P(PSTR("  flash_log.flash_size:     0x0%x, %u\r\n"), flash_log.chip_size, flash_log.chip_size);
+  oStream.printf_P(PSTR("  flashchip->chip_size:     0x0%x, %u\r\n"), flashchip->chip_size, flashchip->chip_size);
+  oStream.printf_P(PSTR("  ESP.getFlashChipSize:     0x0%x, %u\r\n"), ESP.getFlashChipSize(), ESP.getFlashChipSize());
+  oStream.printf_P(PSTR("  ESP.getFlashChipRealSize: 0x0%x, %u\r\n"), ESP.getFlashChipRealSize(), ESP.getFlashChipRealSize());
 }
 
 #endif
@@ -32,6 +32,7 @@ typedef struct ESP_FLASH_DATA {
   uint32_t pre_init;
   uint32_t post_init;
   uint32_t range_error;
+  uint32_t all;               // Every access, any address
   const char *label;
 } esp_flash_data_t;
 